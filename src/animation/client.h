@@ -135,32 +135,124 @@ void snap_scene_buffer_apply_effect(struct wlr_scene_buffer *buffer, int sx,
 								   buffer_data->height);
 }
 
-void scene_buffer_apply_effect(struct wlr_scene_buffer *buffer, int sx, int sy,
-							   void *data) {
-	BufferData *buffer_data = (BufferData *)data;
+void effect_buffer_remove(EffectBuffer *eb) {
+	eb->client->effect_buffers_stale = true;
+	wl_list_remove(&eb->link);
+	wl_list_remove(&eb->node_destroy.link);
+	wl_list_remove(&eb->surface_destroy.link);
+	wl_list_remove(&eb->surface_commit.link);
+	wl_list_remove(&eb->new_subsurface.link);
+	free(eb);
+}
+
+void effect_buffer_node_destroy(struct wl_listener *listener, void *data) {
+	EffectBuffer *eb = wl_container_of(listener, eb, node_destroy);
+	effect_buffer_remove(eb);
+}
 
-	if (buffer_data->should_scale && buffer_data->height_scale < 1 &&
-		buffer_data->width_scale < 1) {
-		buffer_data->should_scale = false;
+void effect_buffer_surface_destroy(struct wl_listener *listener, void *data) {
+	EffectBuffer *eb = wl_container_of(listener, eb, surface_destroy);
+	effect_buffer_remove(eb);
+}
+
+void effect_buffer_surface_commit(struct wl_listener *listener, void *data) {
+	EffectBuffer *eb = wl_container_of(listener, eb, surface_commit);
+	Client *c = eb->client;
+	// 表面大小变了或者提交重置了buffer的目标大小,下次需要重新应用特效
+	if (eb->surface->current.width != eb->applied_width ||
+		eb->surface->current.height != eb->applied_height ||
+		eb->buffer->dst_width != eb->applied_dst_width ||
+		eb->buffer->dst_height != eb->applied_dst_height)
+		c->effect_generation++;
+
+	// 提交会重置buffer的位置和大小,overview缩放需要在下一帧重新应用
+	if (c->overview_scaled && c->mon) {
+		c->need_output_flush = true;
+		wlr_output_schedule_frame(c->mon->wlr_output);
 	}
+}
 
-	if (buffer_data->should_scale && buffer_data->height_scale == 1 &&
-		buffer_data->width_scale < 1) {
-		buffer_data->should_scale = false;
+void effect_buffer_new_subsurface(struct wl_listener *listener, void *data) {
+	EffectBuffer *eb = wl_container_of(listener, eb, new_subsurface);
+	eb->client->effect_buffers_stale = true;
+}
+
+void client_clear_effect_buffers(Client *c) {
+	EffectBuffer *eb, *tmp;
+	wl_list_for_each_safe(eb, tmp, &c->effect_buffers, link) {
+		effect_buffer_remove(eb);
 	}
+	c->effect_buffers_stale = true;
+}
 
-	if (buffer_data->should_scale && buffer_data->height_scale < 1 &&
-		buffer_data->width_scale == 1) {
-		buffer_data->should_scale = false;
+void client_collect_effect_buffers(Client *c, struct wlr_scene_node *node) {
+	struct wlr_scene_node *child;
+	struct wlr_scene_buffer *buffer;
+	struct wlr_scene_surface *scene_surface;
+	EffectBuffer *eb;
+
+	// 包括未启用的节点,子表面map的时候就不需要重新收集
+	if (node->type == WLR_SCENE_NODE_TREE) {
+		wl_list_for_each(child, &wlr_scene_tree_from_node(node)->children,
+						 link) {
+			client_collect_effect_buffers(c, child);
+		}
+		return;
 	}
 
-	struct wlr_scene_surface *scene_surface =
-		wlr_scene_surface_try_from_buffer(buffer);
+	if (node->type != WLR_SCENE_NODE_BUFFER)
+		return;
 
+	buffer = wlr_scene_buffer_from_node(node);
+	scene_surface = wlr_scene_surface_try_from_buffer(buffer);
 	if (scene_surface == NULL)
 		return;
 
-	struct wlr_surface *surface = scene_surface->surface;
+	eb = ecalloc(1, sizeof(*eb));
+	eb->client = c;
+	eb->buffer = buffer;
+	eb->surface = scene_surface->surface;
+
+	if (wlr_subsurface_try_from_wlr_surface(eb->surface) != NULL)
+		eb->role = EffectRoleSubsurface;
+	else if (wlr_xdg_popup_try_from_wlr_surface(eb->surface) != NULL)
+		eb->role = EffectRolePopup;
+	else
+		eb->role = EffectRoleSurface;
+
+	LISTEN(&node->events.destroy, &eb->node_destroy,
+		   effect_buffer_node_destroy);
+	LISTEN(&eb->surface->events.destroy, &eb->surface_destroy,
+		   effect_buffer_surface_destroy);
+	LISTEN(&eb->surface->events.commit, &eb->surface_commit,
+		   effect_buffer_surface_commit);
+	LISTEN(&eb->surface->events.new_subsurface, &eb->new_subsurface,
+		   effect_buffer_new_subsurface);
+	wl_list_insert(c->effect_buffers.prev, &eb->link);
+}
+
+// 子表面增减后重新收集buffer节点
+void client_refresh_effect_buffers(Client *c) {
+	if (!c->effect_buffers_stale)
+		return;
+	client_clear_effect_buffers(c);
+	client_collect_effect_buffers(c, &c->scene_surface->node);
+	c->effect_buffers_stale = false;
+	c->effect_generation++;
+}
+
+bool buffer_data_equal(const BufferData *a, const BufferData *b) {
+	return a->width_scale == b->width_scale &&
+		   a->height_scale == b->height_scale && a->width == b->width &&
+		   a->height == b->height && a->percent == b->percent &&
+		   a->opacity == b->opacity &&
+		   a->corner_location == b->corner_location &&
+		   a->should_scale == b->should_scale;
+}
+
+void scene_buffer_apply_effect(EffectBuffer *eb, BufferData *buffer_data) {
+	struct wlr_scene_buffer *buffer = eb->buffer;
+	struct wlr_surface *surface = eb->surface;
 
 	if (buffer_data->should_scale) {
 
@@ -175,22 +267,22 @@ void scene_buffer_apply_effect(struct wlr_scene_buffer *buffer, int sx, int sy,
 							 : buffer_data->height_scale * surface_height;
 
 		if (surface_width > buffer_data->width &&
-			wlr_subsurface_try_from_wlr_surface(surface) == NULL) {
+			eb->role != EffectRoleSubsurface) {
 			surface_width = buffer_data->width;
 		}
 
 		if (surface_height > buffer_data->height &&
-			wlr_subsurface_try_from_wlr_surface(surface) == NULL) {
+			eb->role != EffectRoleSubsurface) {
 			surface_height = buffer_data->height;
 		}
 
 		if (surface_width > buffer_data->width &&
-			wlr_subsurface_try_from_wlr_surface(surface) != NULL) {
+			eb->role == EffectRoleSubsurface) {
 			return;
 		}
 
 		if (surface_height > buffer_data->height &&
-			wlr_subsurface_try_from_wlr_surface(surface) != NULL) {
+			eb->role == EffectRoleSubsurface) {
 			return;
 		}
 
@@ -201,7 +293,7 @@ void scene_buffer_apply_effect(struct wlr_scene_buffer *buffer, int sx, int sy,
 	}
 	// TODO: blur set, opacity set
 
-	if (wlr_xdg_popup_try_from_wlr_surface(surface) != NULL)
+	if (eb->role == EffectRolePopup)
 		return;
 
 	wlr_scene_buffer_set_corner_radius(buffer, border_radius,
@@ -215,6 +307,7 @@ void scene_buffer_apply_effect(struct wlr_scene_buffer *buffer, int sx, int sy,
 }
 
 void buffer_set_effect(Client *c, BufferData data) {
+	EffectBuffer *eb;
 
 	if (!c || c->iskilling)
 		return;
@@ -227,13 +320,50 @@ void buffer_set_effect(Client *c, BufferData data) {
 	if (c == grabc)
 		data.should_scale = false;
 
+	// 有一个方向缩小时不缩放buffer
+	if (data.should_scale &&
+		((data.height_scale < 1 && data.width_scale <= 1) ||
+		 (data.height_scale <= 1 && data.width_scale < 1))) {
+		data.should_scale = false;
+	}
+
 	if (c->isfullscreen || (no_radius_when_single && c->mon &&
 							c->mon->visible_tiling_clients == 1)) {
 		data.corner_location = CORNER_LOCATION_NONE;
 	}
 
-	wlr_scene_node_for_each_buffer(&c->scene_surface->node,
-								   scene_buffer_apply_effect, &data);
+	client_refresh_effect_buffers(c);
+
+	// 参数和表面都没有变化,不需要重新设置
+	if (c->effect_applied_generation == c->effect_generation &&
+		buffer_data_equal(&c->effect_last_data, &data))
+		return;
+
+	c->effect_applied_generation = c->effect_generation;
+	c->effect_last_data = data;
+
+	wl_list_for_each(eb, &c->effect_buffers, link) {
+		scene_buffer_apply_effect(eb, &data);
+		eb->applied_width = eb->surface->current.width;
+		eb->applied_height = eb->surface->current.height;
+		eb->applied_dst_width = eb->buffer->dst_width;
+		eb->applied_dst_height = eb->buffer->dst_height;
+	}
+}
+
+bool decoration_state_update(struct decoration_state *state,
+							 struct decoration_state next) {
+	if (state->valid && state->enabled == next.enabled &&
+		state->grabbed == next.grabbed &&
+		state->hit_no_border == next.hit_no_border && state->bw == next.bw &&
+		state->radius == next.radius && state->corners == next.corners &&
+		wlr_box_equal(&state->geom, &next.geom) &&
+		wlr_box_equal(&state->mon_box, &next.mon_box))
+		return false;
+
+	*state = next;
+	state->valid = true;
+	return true;
 }
 
 void client_draw_shadow(Client *c) {
@@ -241,18 +371,38 @@ void client_draw_shadow(Client *c) {
 	if (c->iskilling || !client_surface(c)->mapped)
 		return;
 
-	if (!shadows || (!c->isfloating && shadow_only_floating)) {
-		wlr_scene_shadow_set_size(c->shadow, 0, 0);
-		return;
-	}
+	bool shadow_enabled =
+		shadows && (c->isfloating || !shadow_only_floating) &&
+		!(c->mon && c->mon->effect_level >= EffectNoShadow &&
+		  c != c->mon->sel);
 
-	bool hit_no_border = check_hit_no_border(c);
+	bool hit_no_border = shadow_enabled && check_hit_no_border(c);
 	enum corner_location current_corner_location =
 		c->isfullscreen || (no_radius_when_single && c->mon &&
 							c->mon->visible_tiling_clients == 1)
 			? CORNER_LOCATION_NONE
 			: CORNER_LOCATION_ALL;
 
+	// 输入和上次一样时不需要重新设置阴影
+	if (!decoration_state_update(
+			&c->shadow_state,
+			(struct decoration_state){
+				.enabled = shadow_enabled,
+				.grabbed = c == grabc,
+				.hit_no_border = hit_no_border,
+				.bw = c->bw,
+				.radius = border_radius,
+				.corners = current_corner_location,
+				.geom = c->animation.current,
+				.mon_box = c->mon ? c->mon->m : (struct wlr_box){0},
+			}))
+		return;
+
+	if (!shadow_enabled) {
+		wlr_scene_shadow_set_size(c->shadow, 0, 0);
+		return;
+	}
+
 	unsigned int bwoffset = c->bw != 0 && hit_no_border ? c->bw : 0;
 
 	uint32_t width, height;
@@ -347,14 +497,32 @@ void apply_border(Client *c) {
 	if (hit_no_border && smartgaps) {
 		c->bw = 0;
 		c->fake_no_border = true;
-	} else if (hit_no_border && !smartgaps) {
+	} else if (!hit_no_border && !c->isfullscreen && VISIBLEON(c, c->mon)) {
+		c->bw = c->isnoborder ? 0 : borderpx;
+		c->fake_no_border = false;
+	} else if (hit_no_border) {
+		c->fake_no_border = true;
+	}
+
+	// 输入和上次一样时不需要重新设置边框
+	if (!decoration_state_update(
+			&c->border_state,
+			(struct decoration_state){
+				.enabled = !hit_no_border || smartgaps,
+				.grabbed = c == grabc,
+				.hit_no_border = hit_no_border,
+				.bw = c->bw,
+				.radius = border_radius,
+				.corners = current_corner_location,
+				.geom = c->animation.current,
+				.mon_box = c->mon->m,
+			}))
+		return;
+
+	if (hit_no_border && !smartgaps) {
 		wlr_scene_rect_set_size(c->border, 0, 0);
 		wlr_scene_node_set_position(&c->scene_surface->node, c->bw, c->bw);
-		c->fake_no_border = true;
 		return;
-	} else if (!c->isfullscreen && VISIBLEON(c, c->mon)) {
-		c->bw = c->isnoborder ? 0 : borderpx;
-		c->fake_no_border = false;
 	}
 
 	struct wlr_box clip_box = c->animation.current;
@@ -489,11 +657,189 @@ struct ivec2 clip_to_hide(Client *c, struct wlr_box *clip_box) {
 	return offset;
 }
 
+bool client_is_overview_scaled(Client *c) {
+	if (!ov_scale_buffers || !c->mon || c->iskilling)
+		return false;
+	// 退出overview的动画也用缩放,动画结束后再还原buffer
+	return c->mon->isoverview || (c->overview_scaled && c->animation.running);
+}
+
+// overview中窗口保持原来的大小,按格子大小等比例缩小并居中
+void client_fit_overview_cell(Client *c) {
+	struct wlr_box geometry;
+	int bw = (int)c->bw;
+
+	client_get_geometry(c, &geometry);
+	int cell_width = c->geom.width - 2 * bw;
+	int cell_height = c->geom.height - 2 * bw;
+	if (geometry.width <= 0 || geometry.height <= 0 || cell_width <= 0 ||
+		cell_height <= 0)
+		return;
+
+	double scale = MIN(1.0, MIN((double)cell_width / geometry.width,
+								(double)cell_height / geometry.height));
+	int width = MAX(1, (int)round(geometry.width * scale));
+	int height = MAX(1, (int)round(geometry.height * scale));
+
+	c->geom.x += (cell_width - width) / 2;
+	c->geom.y += (cell_height - height) / 2;
+	c->geom.width = width + 2 * bw;
+	c->geom.height = height + 2 * bw;
+}
+
+// 把整个表面树(包括子表面和弹窗)的buffer按比例缩放到窗口动画的当前大小
+void client_apply_overview_scale(Client *c) {
+	struct wlr_box geometry, clip;
+	EffectBuffer *eb;
+	int root_x, root_y, node_x, node_y;
+	int bw = (int)c->bw;
+
+	apply_border(c);
+	client_draw_shadow(c);
+
+	client_get_geometry(c, &geometry);
+	if (geometry.width <= 0 || geometry.height <= 0)
+		return;
+
+	// 只剪掉客户端自己画的阴影,不按格子大小剪切
+	clip = geometry;
+	if (client_is_x11(c)) {
+		clip.x = 0;
+		clip.y = 0;
+	}
+	wlr_scene_node_set_enabled(&c->scene_surface->node, true);
+	wlr_scene_subsurface_tree_set_clip(&c->scene_surface->node, &clip);
+	client_refresh_effect_buffers(c);
+
+	double scale_x =
+		(double)GEZERO(c->animation.current.width - 2 * bw) / geometry.width;
+	double scale_y =
+		(double)GEZERO(c->animation.current.height - 2 * bw) / geometry.height;
+
+	wlr_scene_node_coords(&c->scene_surface->node, &root_x, &root_y);
+	wl_list_for_each(eb, &c->effect_buffers, link) {
+		struct wlr_scene_node *node = &eb->buffer->node;
+		int dst_width = eb->buffer->dst_width ? eb->buffer->dst_width
+											  : eb->surface->current.width;
+		int dst_height = eb->buffer->dst_height
+							 ? eb->buffer->dst_height
+							 : eb->surface->current.height;
+
+		// wlroots在表面提交和剪切变化时会重置位置大小,这时重新记录原始值
+		if (!eb->ov_scaled || node->x != eb->ov_applied.x ||
+			node->y != eb->ov_applied.y || dst_width != eb->ov_applied.width ||
+			dst_height != eb->ov_applied.height)
+			eb->ov_base =
+				(struct wlr_box){node->x, node->y, dst_width, dst_height};
+
+		// 父节点没有被缩放,按相对表面根节点的偏移缩放
+		wlr_scene_node_coords(node, &node_x, &node_y);
+		int parent_x = node_x - node->x - root_x;
+		int parent_y = node_y - node->y - root_y;
+
+		struct wlr_box target = {
+			.x = (int)round((parent_x + eb->ov_base.x) * scale_x) - parent_x,
+			.y = (int)round((parent_y + eb->ov_base.y) * scale_y) - parent_y,
+			.width = MAX(1, (int)round(eb->ov_base.width * scale_x)),
+			.height = MAX(1, (int)round(eb->ov_base.height * scale_y)),
+		};
+		wlr_scene_node_set_position(node, target.x, target.y);
+		wlr_scene_buffer_set_dest_size(eb->buffer, target.width,
+									   target.height);
+		eb->ov_applied = target;
+		eb->ov_scaled = true;
+	}
+	c->overview_scaled = true;
+}
+
+// 上一个configure已经被确认提交,或者客户端太久没有响应
+bool client_configure_acked(Client *c) {
+	if (client_is_x11(c) || !c->configure_serial)
+		return true;
+	if ((int32_t)(c->surface.xdg->current.configure_serial -
+				  c->configure_serial) >= 0)
+		return true;
+	return get_now_in_ns() - c->configure_ns > GRAB_CONFIGURE_TIMEOUT_NS;
+}
+
+// 客户端不再提交,鼠标也不动时,靠定时器在超时后补发最新的大小
+static void arm_grab_configure_timer(Client *c) {
+	uint64_t elapsed = get_now_in_ns() - c->configure_ns;
+	uint64_t remaining = elapsed < GRAB_CONFIGURE_TIMEOUT_NS
+							 ? GRAB_CONFIGURE_TIMEOUT_NS - elapsed
+							 : 0;
+
+	if (grab_configure_timer)
+		wl_event_source_timer_update(grab_configure_timer,
+									 (int)(remaining / 1000000) + 1);
+}
+
+int grab_configure_timeout(void *data) {
+	if (!grabc || cursor_mode != CurResize)
+		return 0;
+	grab_pending = true;
+	if (grabc->mon)
+		wlr_output_schedule_frame(grabc->mon->wlr_output);
+	else
+		flush_interactive_grab(false);
+	return 0;
+}
+
+// 调整大小中buffer还是旧的大小,和overview一样按窗口大小缩放
+static bool client_grab_scaled(Client *c) {
+	struct wlr_box geometry;
+
+	if (c != grabc || cursor_mode != CurResize || client_is_x11(c))
+		return false;
+	client_get_geometry(c, &geometry);
+	return geometry.width != c->geom.width - 2 * (int)c->bw ||
+		   geometry.height != c->geom.height - 2 * (int)c->bw;
+}
+
+// 每帧最多应用一次拖动和调整大小
+void flush_interactive_grab(bool force) {
+	if (!grabc || !grab_pending)
+		return;
+	grab_pending = false;
+	grab_configure_forced = force;
+	resize(grabc, grabc->oldgeom, 1);
+	grab_configure_forced = false;
+}
+
+// 还原overview缩放过的buffer,之后由正常的剪切和特效重新设置
+void client_restore_overview_scale(Client *c) {
+	EffectBuffer *eb;
+
+	wl_list_for_each(eb, &c->effect_buffers, link) {
+		if (!eb->ov_scaled)
+			continue;
+		if (eb->buffer->node.x == eb->ov_applied.x &&
+			eb->buffer->node.y == eb->ov_applied.y)
+			wlr_scene_node_set_position(&eb->buffer->node, eb->ov_base.x,
+										eb->ov_base.y);
+		if (eb->buffer->dst_width == eb->ov_applied.width &&
+			eb->buffer->dst_height == eb->ov_applied.height)
+			wlr_scene_buffer_set_dest_size(eb->buffer, eb->ov_base.width,
+										   eb->ov_base.height);
+		eb->ov_scaled = false;
+	}
+	c->overview_scaled = false;
+	c->effect_generation++;
+}
+
 void client_apply_clip(Client *c, float factor) {
 
 	if (c->iskilling || !client_surface(c)->mapped)
 		return;
 
+	if (client_is_overview_scaled(c)) {
+		client_apply_overview_scale(c);
+		return;
+	}
+
+	if (c->overview_scaled)
+		client_restore_overview_scale(c);
+
 	struct wlr_box clip_box;
 	bool should_render_client_surface = false;
 	struct ivec2 offset;
@@ -860,10 +1206,17 @@ void client_commit(Client *c) {
 }
 
 void client_set_pending_state(Client *c) {
+	struct wlr_box clip_box;
 
 	// 判断是否需要动画
 	if (!animations) {
 		c->animation.should_animate = false;
+	} else if (c->mon && c->mon->effect_level >= EffectNoAnim &&
+			   !wlr_box_intersection(&clip_box, &c->animainit_geom,
+									 &c->mon->m) &&
+			   !wlr_box_intersection(&clip_box, &c->pending, &c->mon->m)) {
+		// 降级时跳过起点和终点都在屏幕外的窗口动画
+		c->animation.should_animate = false;
 	} else if (animations && c->animation.tagining) {
 		c->animation.should_animate = true;
 	} else if (!animations || c == grabc ||
@@ -921,6 +1274,10 @@ void resize(Client *c, struct wlr_box geo, int interact) {
 			bbox); // 去掉这个推荐的窗口大小,因为有时推荐的窗口特别大导致平铺异常
 	}
 
+	bool overview_scaled = c->mon->isoverview && ov_scale_buffers;
+	if (overview_scaled)
+		client_fit_overview_cell(c);
+
 	if (!c->is_pending_open_animation) {
 		c->animation.begin_fade_in = false;
 	}
@@ -959,8 +1316,19 @@ void resize(Client *c, struct wlr_box geo, int interact) {
 	}
 
 	// c->geom 是真实的窗口大小和位置，跟过度的动画无关，用于计算布局
-	c->configure_serial = client_set_size(c, c->geom.width - 2 * c->bw,
+	// overview缩放画面时窗口大小不变,不发送configure
+	// 拖动调整大小时上一个configure确认之前不发新的
+	if (!overview_scaled &&
+		(c != grabc || grab_configure_forced || client_configure_acked(c))) {
+		uint32_t serial = client_set_size(c, c->geom.width - 2 * c->bw,
 										  c->geom.height - 2 * c->bw);
+		if (serial) {
+			c->configure_serial = serial;
+			c->configure_ns = get_now_in_ns();
+		}
+	} else if (!overview_scaled) {
+		arm_grab_configure_timer(c);
+	}
 
 	if (c == grabc) {
 		c->animation.running = false;
@@ -969,6 +1337,14 @@ void resize(Client *c, struct wlr_box geo, int interact) {
 			c->geom;
 		wlr_scene_node_set_position(&c->scene->node, c->geom.x, c->geom.y);
 
+		// 客户端还没按新大小提交时先缩放旧的buffer
+		if (client_grab_scaled(c)) {
+			client_apply_overview_scale(c);
+			return;
+		}
+		if (c->overview_scaled)
+			client_restore_overview_scale(c);
+
 		client_draw_shadow(c);
 		apply_border(c);
 		client_get_clip(c, &clip);
@@ -230,4 +230,96 @@ struct wlr_scene_tree *wlr_scene_tree_snapshot(struct wlr_scene_node *node,
 	wlr_scene_node_set_enabled(&snapshot->node, true);
 
 	return snapshot;
-}
\ No newline at end of file
+}
+
+void set_effect_blur_data(void) {
+	Monitor *m;
+	int level = EffectFull;
+	int num_passes = blur_params.num_passes;
+
+	// blur参数是整个场景共用的,按等级最低的显示器来设置
+	wl_list_for_each(m, &mons, link) { level = MAX(level, m->effect_level); }
+
+	if (level >= EffectLowBlur)
+		num_passes = MIN(num_passes, MAX(1, num_passes / 2));
+
+	wlr_scene_set_blur_data(scene, num_passes, blur_params.radius,
+							blur_params.noise, blur_params.brightness,
+							blur_params.contrast, blur_params.saturation);
+}
+
+void effect_governor_set_level(Monitor *m, int level) {
+	Client *c;
+
+	if (m->effect_level == level)
+		return;
+
+	wlr_log(WLR_DEBUG, "effect level of %s: %d -> %d", m->wlr_output->name,
+			m->effect_level, level);
+
+	m->effect_level = level;
+	m->effect_over_frames = 0;
+	m->effect_under_frames = 0;
+
+	if (blur)
+		set_effect_blur_data();
+
+	// 重新绘制该显示器上窗口的阴影
+	wl_list_for_each(c, &clients, link) {
+		if (c->mon == m && VISIBLEON(c, m))
+			client_draw_shadow(c);
+	}
+}
+
+// frame_ns是从提交到实际显示的延迟,包括了GPU渲染的时间
+void effect_governor_update(Monitor *m, uint64_t commit_ns,
+							uint64_t present_ns) {
+	uint64_t frame_ns = present_ns - commit_ns;
+	uint64_t interval_ns, idle_ns;
+
+	if (!effect_governor || m->wlr_output->refresh <= 0)
+		return;
+
+	// refresh 的单位是mHz
+	interval_ns = 1000000000000ULL / m->wlr_output->refresh;
+	idle_ns = commit_ns > m->last_frame_ns ? commit_ns - m->last_frame_ns : 0;
+	m->last_frame_ns = present_ns;
+
+	// 长时间没有渲染说明负载已经过去,直接恢复一级
+	if (m->effect_level > EffectFull &&
+		idle_ns > interval_ns * effect_governor_frames) {
+		m->frame_time_avg_ns = frame_ns;
+		effect_governor_set_level(m, m->effect_level - 1);
+		return;
+	}
+
+	// 指数滑动平均,避免单帧抖动导致频繁切换等级
+	m->frame_time_avg_ns = m->frame_time_avg_ns
+							   ? (m->frame_time_avg_ns * 7 + frame_ns) / 8
+							   : frame_ns;
+
+	if (m->frame_time_avg_ns * 100 > interval_ns * effect_governor_budget) {
+		m->effect_under_frames = 0;
+		if (++m->effect_over_frames >= effect_governor_frames &&
+			m->effect_level < EffectNoAnim)
+			effect_governor_set_level(m, m->effect_level + 1);
+	} else if (m->frame_time_avg_ns * 100 <
+			   interval_ns * effect_governor_restore) {
+		m->effect_over_frames = 0;
+		if (++m->effect_under_frames >= effect_governor_frames &&
+			m->effect_level > EffectFull)
+			effect_governor_set_level(m, m->effect_level - 1);
+	} else {
+		m->effect_over_frames = 0;
+		m->effect_under_frames = 0;
+	}
+}
+
+void reset_effect_governor(void) {
+	Monitor *m;
+
+	wl_list_for_each(m, &mons, link) {
+		m->frame_time_avg_ns = 0;
+		effect_governor_set_level(m, EffectFull);
+	}
+}
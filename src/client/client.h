@@ -129,6 +129,11 @@ static inline const char *client_get_appid(Client *c) {
 											: "broken";
 }
 
+/* 限频后的标题/appid,还没发布过时取实时值 */
+static inline const char *client_published_appid(Client *c) {
+	return c->published_appid ? c->published_appid : client_get_appid(c);
+}
+
 static inline int client_get_pid(Client *c) {
 	pid_t pid;
 #ifdef XWAYLAND
@@ -205,6 +210,10 @@ static inline const char *client_get_title(Client *c) {
 										   : "broken";
 }
 
+static inline const char *client_published_title(Client *c) {
+	return c->published_title ? c->published_title : client_get_title(c);
+}
+
 static inline int client_is_float_type(Client *c) {
 	struct wlr_xdg_toplevel *toplevel;
 	struct wlr_xdg_toplevel_state state;
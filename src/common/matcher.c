@@ -0,0 +1,361 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matcher.h"
+#include "util.h"
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+enum {
+	PATTERN_EXACT,	   // ^lit$
+	PATTERN_PREFIX,	   // ^lit
+	PATTERN_SUFFIX,	   // lit$
+	PATTERN_SUBSTRING, // lit
+	PATTERN_REGEX,
+};
+
+typedef struct TrieNode {
+	unsigned char ch;
+	struct TrieNode *child;
+	struct TrieNode *sibling;
+	unsigned int *ids;
+	unsigned int ids_count;
+} TrieNode;
+
+typedef struct LiteralEntry {
+	char *lit;
+	size_t len;
+	uint32_t hash;
+	unsigned int id;
+	struct LiteralEntry *next;
+} LiteralEntry;
+
+struct PatternSet {
+	LiteralEntry **exact;
+	unsigned int exact_size;
+	unsigned int exact_count;
+
+	TrieNode prefix;
+	TrieNode suffix;	// 反向存储
+	TrieNode substring;
+
+	pcre2_code **regexes; // 其余的模式各自预编译,逐个匹配
+	unsigned int *regex_ids;
+	unsigned int regex_count;
+
+	pcre2_match_data *match_data;
+};
+
+static uint32_t literal_hash(const char *s, size_t len) {
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)s[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void ids_append(unsigned int **ids, unsigned int *count,
+					   unsigned int id) {
+	unsigned int *tmp = realloc(*ids, (*count + 1) * sizeof(**ids));
+
+	if (!tmp)
+		die("realloc:");
+	*ids = tmp;
+	(*ids)[(*count)++] = id;
+}
+
+static void ids_mark(const unsigned int *ids, unsigned int count,
+					 unsigned char *matched) {
+	for (unsigned int i = 0; i < count; i++)
+		matched[ids[i]] = 1;
+}
+
+static TrieNode *trie_child(const TrieNode *node, unsigned char ch) {
+	for (TrieNode *child = node->child; child; child = child->sibling) {
+		if (child->ch == ch)
+			return child;
+	}
+	return NULL;
+}
+
+static void trie_insert(TrieNode *root, const char *lit, size_t len,
+						bool reverse, unsigned int id) {
+	TrieNode *node = root, *child;
+
+	for (size_t i = 0; i < len; i++) {
+		unsigned char ch = lit[reverse ? len - 1 - i : i];
+
+		if (!(child = trie_child(node, ch))) {
+			child = ecalloc(1, sizeof(*child));
+			child->ch = ch;
+			child->sibling = node->child;
+			node->child = child;
+		}
+		node = child;
+	}
+	ids_append(&node->ids, &node->ids_count, id);
+}
+
+static void trie_free(TrieNode *node) {
+	TrieNode *child = node->child, *next;
+
+	while (child) {
+		next = child->sibling;
+		trie_free(child);
+		free(child);
+		child = next;
+	}
+	free(node->ids);
+}
+
+/* 沿字典树走一遍,路径上每个节点的模式都匹配 */
+static void trie_walk(const TrieNode *root, const char *str, size_t len,
+					  bool reverse, unsigned char *matched) {
+	const TrieNode *node = root;
+
+	for (size_t i = 0; i < len && node->child; i++) {
+		if (!(node = trie_child(node, str[reverse ? len - 1 - i : i])))
+			return;
+		ids_mark(node->ids, node->ids_count, matched);
+	}
+}
+
+static void exact_insert(PatternSet *set, const char *lit, size_t len,
+						 unsigned int id) {
+	LiteralEntry *entry;
+
+	if (set->exact_count >= set->exact_size) {
+		unsigned int size = set->exact_size ? set->exact_size * 2 : 16;
+		LiteralEntry **buckets = ecalloc(size, sizeof(*buckets));
+
+		for (unsigned int i = 0; i < set->exact_size; i++) {
+			while ((entry = set->exact[i])) {
+				set->exact[i] = entry->next;
+				entry->next = buckets[entry->hash & (size - 1)];
+				buckets[entry->hash & (size - 1)] = entry;
+			}
+		}
+		free(set->exact);
+		set->exact = buckets;
+		set->exact_size = size;
+	}
+
+	entry = ecalloc(1, sizeof(*entry));
+	entry->lit = ecalloc(len + 1, 1);
+	memcpy(entry->lit, lit, len);
+	entry->len = len;
+	entry->hash = literal_hash(lit, len);
+	entry->id = id;
+	entry->next = set->exact[entry->hash & (set->exact_size - 1)];
+	set->exact[entry->hash & (set->exact_size - 1)] = entry;
+	set->exact_count++;
+}
+
+static void exact_lookup(const PatternSet *set, const char *str, size_t len,
+						 unsigned char *matched) {
+	uint32_t hash;
+
+	if (!set->exact_count)
+		return;
+
+	hash = literal_hash(str, len);
+	for (LiteralEntry *entry = set->exact[hash & (set->exact_size - 1)];
+		 entry; entry = entry->next) {
+		if (entry->hash == hash && entry->len == len &&
+			memcmp(entry->lit, str, len) == 0)
+			matched[entry->id] = 1;
+	}
+}
+
+static bool is_escaped(const char *start, const char *p) {
+	size_t backslashes = 0;
+
+	while (p > start && p[-1] == '\\') {
+		backslashes++;
+		p--;
+	}
+	return backslashes % 2;
+}
+
+/* 判断模式是否只是一个字面串,是则把去掉转义的字面串写到lit.
+ * 匹配是非锚定的搜索,所以不靠^$锚定的一端上的.*可以直接去掉 */
+static int classify_pattern(const char *pattern, char *lit, size_t *len) {
+	const char *p = pattern, *end = pattern + strlen(pattern);
+	bool anchored_start = false, anchored_end = false;
+	size_t n = 0;
+
+	if (*p == '^') {
+		anchored_start = true;
+		p++;
+	} else {
+		while (end - p >= 2 && p[0] == '.' && p[1] == '*')
+			p += 2;
+	}
+
+	if (end > p && end[-1] == '$' && !is_escaped(p, end - 1)) {
+		anchored_end = true;
+		end--;
+	} else {
+		while (end - p >= 2 && end[-2] == '.' && end[-1] == '*' &&
+			   !is_escaped(p, end - 2))
+			end -= 2;
+	}
+
+	for (; p < end; p++) {
+		if (*p == '\\') {
+			// 只有转义的标点是字面字符,\d \w \Q之类都交给正则
+			if (p + 1 >= end || !ispunct((unsigned char)p[1]))
+				return PATTERN_REGEX;
+			lit[n++] = *++p;
+		} else if (strchr(".^$|?*+()[]{}", *p)) {
+			return PATTERN_REGEX;
+		} else {
+			lit[n++] = *p;
+		}
+	}
+	*len = n;
+
+	if (anchored_start && anchored_end)
+		return PATTERN_EXACT;
+	if (anchored_start)
+		return PATTERN_PREFIX;
+	if (anchored_end)
+		return PATTERN_SUFFIX;
+	return PATTERN_SUBSTRING;
+}
+
+static pcre2_code *compile_regex(const char *pattern) {
+	int errnum;
+	PCRE2_SIZE erroffset;
+	pcre2_code *re = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED,
+								   PCRE2_UTF, &errnum, &erroffset, NULL);
+
+	if (!re) {
+		PCRE2_UCHAR errbuf[256];
+		pcre2_get_error_message(errnum, errbuf, sizeof(errbuf));
+		fprintf(stderr, "PCRE2 error: %s at offset %zu\n", errbuf, erroffset);
+	}
+	return re;
+}
+
+static void regex_add(PatternSet *set, const char *pattern, unsigned int id) {
+	pcre2_code **regexes;
+	pcre2_code *re;
+
+	// 错误的模式在这里报告并丢弃,和逐条匹配时一样不匹配
+	if (!(re = compile_regex(pattern)))
+		return;
+	// 没有JIT支持时pcre2_match退回解释执行
+	pcre2_jit_compile(re, PCRE2_JIT_COMPLETE);
+
+	regexes = realloc(set->regexes, (set->regex_count + 1) * sizeof(*regexes));
+	if (!regexes)
+		die("realloc:");
+	set->regexes = regexes;
+	set->regexes[set->regex_count] = re;
+	ids_append(&set->regex_ids, &set->regex_count, id);
+}
+
+PatternSet *pattern_set_create(void) { return ecalloc(1, sizeof(PatternSet)); }
+
+void pattern_set_add(PatternSet *set, const char *pattern, unsigned int id) {
+	char *lit;
+	size_t len = 0;
+
+	if (!pattern)
+		return;
+
+	lit = ecalloc(strlen(pattern) + 1, 1);
+	switch (classify_pattern(pattern, lit, &len)) {
+	case PATTERN_EXACT:
+		exact_insert(set, lit, len, id);
+		break;
+	case PATTERN_PREFIX:
+		trie_insert(&set->prefix, lit, len, false, id);
+		break;
+	case PATTERN_SUFFIX:
+		trie_insert(&set->suffix, lit, len, true, id);
+		break;
+	case PATTERN_SUBSTRING:
+		trie_insert(&set->substring, lit, len, false, id);
+		break;
+	default:
+		regex_add(set, pattern, id);
+		break;
+	}
+	free(lit);
+}
+
+void pattern_set_compile(PatternSet *set) {
+	if (set->regex_count && !set->match_data)
+		set->match_data = pcre2_match_data_create(1, NULL);
+}
+
+void pattern_set_match(PatternSet *set, const char *str,
+					   unsigned char *matched) {
+	size_t len;
+
+	if (!str)
+		return;
+
+	len = strlen(str);
+	exact_lookup(set, str, len, matched);
+	ids_mark(set->prefix.ids, set->prefix.ids_count, matched);
+	trie_walk(&set->prefix, str, len, false, matched);
+	ids_mark(set->suffix.ids, set->suffix.ids_count, matched);
+	trie_walk(&set->suffix, str, len, true, matched);
+	// $也能匹配结尾换行符之前的位置
+	if (len && str[len - 1] == '\n') {
+		exact_lookup(set, str, len - 1, matched);
+		trie_walk(&set->suffix, str, len - 1, true, matched);
+	}
+	ids_mark(set->substring.ids, set->substring.ids_count, matched);
+	for (size_t i = 0; set->substring.child && i < len; i++)
+		trie_walk(&set->substring, str + i, len - i, false, matched);
+
+	for (unsigned int i = 0; i < set->regex_count; i++) {
+		if (matched[set->regex_ids[i]])
+			continue;
+		// 超出匹配限制等错误和regex_match一样按不匹配处理
+		if (pcre2_match(set->regexes[i], (PCRE2_SPTR)str, len, 0, 0,
+						set->match_data, NULL) >= 0)
+			matched[set->regex_ids[i]] = 1;
+	}
+}
+
+void pattern_set_destroy(PatternSet *set) {
+	LiteralEntry *entry;
+
+	if (!set)
+		return;
+
+	for (unsigned int i = 0; i < set->exact_size; i++) {
+		while ((entry = set->exact[i])) {
+			set->exact[i] = entry->next;
+			free(entry->lit);
+			free(entry);
+		}
+	}
+	free(set->exact);
+
+	trie_free(&set->prefix);
+	trie_free(&set->suffix);
+	trie_free(&set->substring);
+
+	for (unsigned int i = 0; i < set->regex_count; i++)
+		pcre2_code_free(set->regexes[i]);
+	free(set->regexes);
+	free(set->regex_ids);
+
+	if (set->match_data)
+		pcre2_match_data_free(set->match_data);
+	free(set);
+}
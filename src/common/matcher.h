@@ -0,0 +1,13 @@
+/* See LICENSE.dwm file for copyright and license details. */
+
+/* 一组PCRE2模式一次匹配,得到所有匹配的模式id.
+ * 只含字面字符的模式走哈希表和字典树,其余的各自预编译 */
+typedef struct PatternSet PatternSet;
+
+PatternSet *pattern_set_create(void);
+void pattern_set_add(PatternSet *set, const char *pattern, unsigned int id);
+void pattern_set_compile(PatternSet *set);
+/* matched按id索引,调用者清零,匹配的模式对应位置设为1 */
+void pattern_set_match(PatternSet *set, const char *str,
+					   unsigned char *matched);
+void pattern_set_destroy(PatternSet *set);
@@ -1,9 +1,12 @@
 /* See LICENSE.dwm file for copyright and license details. */
 #include <fcntl.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "util.h"
 
@@ -76,3 +79,25 @@ int regex_match(const char *pattern, const char *str) {
 	pcre2_code_free(re);
 	return ret >= 0;
 }
+
+uint64_t get_now_in_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+long get_rss_kb(int pid) {
+	char path[64];
+	long size, resident;
+	FILE *file;
+
+	snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+	if (!(file = fopen(path, "r")))
+		return -1;
+	if (fscanf(file, "%ld %ld", &size, &resident) != 2)
+		resident = -1;
+	fclose(file);
+
+	return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
@@ -4,3 +4,5 @@ void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
 int fd_set_nonblock(int fd);
 int regex_match(const char *pattern_mb, const char *str_mb);
+uint64_t get_now_in_ns(void);
+long get_rss_kb(int pid);
@@ -1,7 +1,12 @@
 #include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
 
 #ifndef SYSCONFDIR
 #define SYSCONFDIR "/etc"
@@ -61,6 +66,8 @@ typedef struct {
 	int isterm;
 	int noswallow;
 	int noblur;
+	int allow_tearing;
+	int hidden_frame_rate;
 	int scratchpad_width;
 	int scratchpad_height;
 	float focused_opacity;
@@ -135,6 +142,163 @@ typedef struct {
 	int noshadow;
 } ConfigLayerRule;
 
+// 配置数据统一分配在arena中,重载时整块释放
+#define CONFIG_ARENA_ALIGN 16
+
+typedef struct ConfigArenaBlock {
+	struct ConfigArenaBlock *next;
+	size_t size;
+	size_t used;
+	// 头部是24字节,data要单独对齐,分配出去的指针才是16字节对齐
+	_Alignas(CONFIG_ARENA_ALIGN) char data[];
+} ConfigArenaBlock;
+
+typedef struct {
+	ConfigArenaBlock *head;
+	size_t next_size;
+	void *last; // 最近一次分配,用于原地扩容
+	size_t last_size;
+} ConfigArena;
+
+#define CONFIG_ARENA_MIN_BLOCK 16384
+#define CONFIG_ARENA_MAX_BLOCK (1 << 20)
+
+void *config_arena_alloc(ConfigArena *arena, size_t size) {
+	ConfigArenaBlock *block = arena->head;
+	size_t offset, block_size;
+
+	size = (size + CONFIG_ARENA_ALIGN - 1) & ~(size_t)(CONFIG_ARENA_ALIGN - 1);
+
+	if (!block || block->size - block->used < size) {
+		block_size =
+			arena->next_size ? arena->next_size : CONFIG_ARENA_MIN_BLOCK;
+		while (block_size < size)
+			block_size *= 2;
+		block = malloc(sizeof(ConfigArenaBlock) + block_size);
+		if (!block)
+			return NULL;
+		block->next = arena->head;
+		block->size = block_size;
+		block->used = 0;
+		arena->head = block;
+		if (block_size < CONFIG_ARENA_MAX_BLOCK)
+			arena->next_size = block_size * 2;
+	}
+
+	offset = block->used;
+	block->used += size;
+	arena->last = block->data + offset;
+	arena->last_size = size;
+	memset(arena->last, 0, size);
+	return arena->last;
+}
+
+void *config_arena_realloc(ConfigArena *arena, void *ptr, size_t old_size,
+						   size_t new_size) {
+	ConfigArenaBlock *block = arena->head;
+	void *new_ptr;
+
+	if (!ptr)
+		return config_arena_alloc(arena, new_size);
+
+	new_size = (new_size + CONFIG_ARENA_ALIGN - 1) &
+			   ~(size_t)(CONFIG_ARENA_ALIGN - 1);
+
+	// 最后一次分配且块内还有空间时直接原地扩展
+	if (ptr == arena->last && new_size >= arena->last_size &&
+		block->size - block->used >= new_size - arena->last_size) {
+		memset((char *)ptr + arena->last_size, 0, new_size - arena->last_size);
+		block->used += new_size - arena->last_size;
+		arena->last_size = new_size;
+		return ptr;
+	}
+
+	new_ptr = config_arena_alloc(arena, new_size);
+	if (new_ptr)
+		memcpy(new_ptr, ptr, old_size);
+	return new_ptr;
+}
+
+char *config_arena_strdup(ConfigArena *arena, const char *str) {
+	size_t len = strlen(str) + 1;
+	char *copy = config_arena_alloc(arena, len);
+
+	if (copy)
+		memcpy(copy, str, len);
+	return copy;
+}
+
+// 按几何级数扩容数组,返回false表示分配失败
+bool config_arena_reserve(ConfigArena *arena, void **array, int count,
+						  int *cap, size_t elem_size) {
+	int new_cap;
+	void *new_array;
+
+	if (count < *cap)
+		return true;
+
+	new_cap = *cap ? *cap * 2 : 8;
+	new_array = config_arena_realloc(arena, *array, (size_t)*cap * elem_size,
+									 (size_t)new_cap * elem_size);
+	if (!new_array)
+		return false;
+
+	*array = new_array;
+	*cap = new_cap;
+	return true;
+}
+
+void config_arena_release(ConfigArena *arena) {
+	ConfigArenaBlock *block = arena->head, *next;
+
+	while (block) {
+		next = block->next;
+		free(block);
+		block = next;
+	}
+	memset(arena, 0, sizeof(*arena));
+}
+
+#define CONFIG_ARRAY_RESERVE(cfg, name)                                        \
+	config_arena_reserve(&(cfg)->arena, (void **)&(cfg)->name,                 \
+						 (cfg)->name##_count, &(cfg)->name##_cap,              \
+						 sizeof(*(cfg)->name))
+
+typedef struct {
+	char *name;
+	char *value;
+} ConfigEnv;
+
+// 文件的大小,修改时间和inode,用来判断配置文件是否变化
+typedef struct {
+	int64_t size; // -1表示文件不存在
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	uint64_t ino;
+} FileStamp;
+
+typedef struct {
+	char *path;
+	FileStamp stamp;
+} ConfigFile;
+
+bool file_stamp_get(const char *path, FileStamp *stamp) {
+	struct stat st;
+
+	if (stat(path, &st) < 0) {
+		*stamp = (FileStamp){.size = -1};
+		return false;
+	}
+	*stamp = (FileStamp){st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec,
+						 st.st_ino};
+	return true;
+}
+
+bool file_stamp_equal(const FileStamp *a, const FileStamp *b) {
+	return a->size == b->size && a->mtime_sec == b->mtime_sec &&
+		   a->mtime_nsec == b->mtime_nsec && a->ino == b->ino;
+}
+
 typedef struct {
 	int animations;
 	int layer_animations;
@@ -187,11 +351,13 @@ typedef struct {
 	unsigned int hotarea_size;
 	unsigned int enable_hotarea;
 	unsigned int ov_tab_mode;
+	unsigned int ov_scale_buffers;
 	int overviewgappi;
 	int overviewgappo;
 	unsigned int cursor_hide_timeout;
 
 	unsigned int axis_bind_apply_timeout;
+	unsigned int title_update_interval;
 	unsigned int focus_on_activate;
 	int inhibit_regardless_of_visibility;
 	int sloppyfocus;
@@ -234,6 +400,11 @@ typedef struct {
 	int shadows_position_y;
 	float shadowscolor[4];
 
+	int effect_governor;
+	int effect_governor_budget;
+	int effect_governor_restore;
+	int effect_governor_frames;
+
 	int smartgaps;
 	unsigned int gappih;
 	unsigned int gappiv;
@@ -255,48 +426,103 @@ typedef struct {
 
 	ConfigTagRule *tag_rules; // 动态数组
 	int tag_rules_count;	  // 数量
+	int tag_rules_cap;
 
 	ConfigLayerRule *layer_rules; // 动态数组
 	int layer_rules_count;		  // 数量
+	int layer_rules_cap;
 
 	ConfigWinRule *window_rules;
 	int window_rules_count;
+	int window_rules_cap;
 
 	ConfigMonitorRule *monitor_rules; // 动态数组
 	int monitor_rules_count;		  // 条数
+	int monitor_rules_cap;
 
 	KeyBinding *key_bindings;
 	int key_bindings_count;
+	int key_bindings_cap;
 
 	MouseBinding *mouse_bindings;
 	int mouse_bindings_count;
+	int mouse_bindings_cap;
 
 	AxisBinding *axis_bindings;
 	int axis_bindings_count;
+	int axis_bindings_cap;
 
 	GestureBinding *gesture_bindings;
 	int gesture_bindings_count;
+	int gesture_bindings_cap;
 
 	char **exec;
 	int exec_count;
+	int exec_cap;
 
 	char **exec_once;
 	int exec_once_count;
+	int exec_once_cap;
 
 	char *cursor_theme;
 	unsigned int cursor_size;
 
 	int single_scratchpad;
 	int xwayland_persistence;
+	int xwayland_lazy;
+	int xwayland_prewarm_delay;
 	int syncobj_enable;
+	int allow_tearing;
+	int hidden_frame_rate;
+	int asleep_frame_rate;
 
 	struct xkb_rule_names xkb_rules;
+	char xkb_rules_rules[256];
+	char xkb_rules_model[256];
+	char xkb_rules_layout[256];
+	char xkb_rules_variant[256];
+	char xkb_rules_options[256];
+
+	ConfigEnv *env; // env 在主线程发布配置时才设置
+	int env_count;
+	int env_cap;
+
+	int config_auto_reload;
+
+	ConfigFile *files; // 解析时读取过的文件,包括source引入的
+	int files_count;
+	int files_cap;
+
+	// 新增指针字段时需要同步修改serialize.h
+	ConfigArena arena;
 } Config;
 
 typedef void (*FuncType)(const Arg *);
 Config config;
+static unsigned int config_generation;
+
+// 后台解析的配置任务,解析完通过eventfd通知主线程发布
+typedef struct {
+	Config config;
+	char path[1024];
+} ConfigJob;
+
+static pthread_t config_thread;
+static bool config_thread_running;
+static bool config_reload_queued;
+static _Atomic(ConfigJob *) config_job_done;
+static int config_event_fd = -1;
+static struct wl_event_source *config_event_source;
+
+static int config_watch_fd = -1;
+static struct wl_event_source *config_watch_source;
+static struct wl_event_source *config_watch_timer;
+
+void update_config_watch(void);
 
 void parse_config_file(Config *config, const char *file_path);
+bool config_cache_load(Config *config, const char *config_path);
+void config_cache_save(const Config *config, const char *config_path);
 
 // Helper function to trim whitespace from start and end of a string
 void trim_whitespace(char *str) {
@@ -326,10 +552,10 @@ void trim_whitespace(char *str) {
 
 int parse_double_array(const char *input, double *output, int max_count) {
 	char *dup = strdup(input); // 复制一份用于修改
-	char *token;
+	char *token, *saveptr;
 	int count = 0;
 
-	token = strtok(dup, ",");
+	token = strtok_r(dup, ",", &saveptr);
 	while (token != NULL && count < max_count) {
 		trim_whitespace(token); // 对每一个分割后的 token 去除前后空格
 		char *endptr;
@@ -340,7 +566,7 @@ int parse_double_array(const char *input, double *output, int max_count) {
 			return -1; // 解析失败
 		}
 		output[count++] = val;
-		token = strtok(NULL, ",");
+		token = strtok_r(NULL, ",", &saveptr);
 	}
 
 	free(dup);
@@ -658,172 +884,222 @@ unsigned int parse_num_type(char *str) {
 	}
 }
 
-FuncType parse_func_name(char *func_name, Arg *arg, char *arg_value,
-						 char *arg_value2, char *arg_value3, char *arg_value4,
-						 char *arg_value5) {
+enum {
+	DISPATCH_ARG_NONE,
+	DISPATCH_ARG_CIRCLE_DIR,
+	DISPATCH_ARG_DIR,
+	DISPATCH_ARG_INT,
+	DISPATCH_ARG_UINT,
+	DISPATCH_ARG_FLOAT,
+	DISPATCH_ARG_TAG,
+	DISPATCH_ARG_STRING,
+	DISPATCH_ARG_DIR_OR_NAME,
+	DISPATCH_ARG_DIR_UINT,
+	DISPATCH_ARG_STRING_TAG,
+	DISPATCH_ARG_MOUSE_ACTION,
+	DISPATCH_ARG_NUM_PAIR,
+	DISPATCH_ARG_SCRATCHPAD,
+};
+
+typedef struct {
+	const char *name;
+	FuncType func;
+	int arg_type;
+} Dispatcher;
+
+static const Dispatcher dispatchers[] = {
+	{"focusstack", focusstack, DISPATCH_ARG_CIRCLE_DIR},
+	{"focusdir", focusdir, DISPATCH_ARG_DIR},
+	{"incnmaster", incnmaster, DISPATCH_ARG_INT},
+	{"setmfact", setmfact, DISPATCH_ARG_FLOAT},
+	{"setsmfact", setsmfact, DISPATCH_ARG_FLOAT},
+	{"zoom", zoom, DISPATCH_ARG_NONE},
+	{"exchange_client", exchange_client, DISPATCH_ARG_DIR},
+	{"toggleglobal", toggleglobal, DISPATCH_ARG_NONE},
+	{"toggleoverview", toggleoverview, DISPATCH_ARG_NONE},
+	{"set_proportion", set_proportion, DISPATCH_ARG_FLOAT},
+	{"increase_proportion", increase_proportion, DISPATCH_ARG_FLOAT},
+	{"switch_proportion_preset", switch_proportion_preset, DISPATCH_ARG_NONE},
+	{"viewtoleft", viewtoleft, DISPATCH_ARG_NONE},
+	{"viewtoright", viewtoright, DISPATCH_ARG_NONE},
+	{"tagsilent", tagsilent, DISPATCH_ARG_TAG},
+	{"tagtoleft", tagtoleft, DISPATCH_ARG_NONE},
+	{"tagtoright", tagtoright, DISPATCH_ARG_NONE},
+	{"killclient", killclient, DISPATCH_ARG_NONE},
+	{"focuslast", focuslast, DISPATCH_ARG_NONE},
+	{"setlayout", setlayout, DISPATCH_ARG_STRING},
+	{"switch_layout", switch_layout, DISPATCH_ARG_NONE},
+	{"switch_keyboard_layout", switch_keyboard_layout, DISPATCH_ARG_NONE},
+	{"togglefloating", togglefloating, DISPATCH_ARG_NONE},
+	{"togglefullscreen", togglefullscreen, DISPATCH_ARG_NONE},
+	{"togglefakefullscreen", togglefakefullscreen, DISPATCH_ARG_NONE},
+	{"toggleoverlay", toggleoverlay, DISPATCH_ARG_NONE},
+	{"minized", minized, DISPATCH_ARG_NONE},
+	{"restore_minized", restore_minized, DISPATCH_ARG_NONE},
+	{"toggle_scratchpad", toggle_scratchpad, DISPATCH_ARG_NONE},
+	{"toggle_render_border", toggle_render_border, DISPATCH_ARG_NONE},
+	{"focusmon", focusmon, DISPATCH_ARG_DIR_OR_NAME},
+	{"tagmon", tagmon, DISPATCH_ARG_DIR_UINT},
+	{"incgaps", incgaps, DISPATCH_ARG_INT},
+	{"togglegaps", togglegaps, DISPATCH_ARG_NONE},
+	{"chvt", chvt, DISPATCH_ARG_UINT},
+	{"spawn", spawn, DISPATCH_ARG_STRING},
+	{"spawn_on_empty", spawn_on_empty, DISPATCH_ARG_STRING_TAG},
+	{"quit", quit, DISPATCH_ARG_NONE},
+	{"create_virtual_output", create_virtual_output, DISPATCH_ARG_NONE},
+	{"destroy_all_virtual_output", destroy_all_virtual_output,
+	 DISPATCH_ARG_NONE},
+	{"moveresize", moveresize, DISPATCH_ARG_MOUSE_ACTION},
+	{"togglemaxmizescreen", togglemaxmizescreen, DISPATCH_ARG_NONE},
+	{"viewtoleft_have_client", viewtoleft_have_client, DISPATCH_ARG_NONE},
+	{"viewtoright_have_client", viewtoright_have_client, DISPATCH_ARG_NONE},
+	{"reload_config", reload_config, DISPATCH_ARG_NONE},
+	{"tag", tag, DISPATCH_ARG_TAG},
+	{"view", bind_to_view, DISPATCH_ARG_TAG},
+	{"toggletag", toggletag, DISPATCH_ARG_TAG},
+	{"toggleview", toggleview, DISPATCH_ARG_TAG},
+	{"smartmovewin", smartmovewin, DISPATCH_ARG_DIR},
+	{"smartresizewin", smartresizewin, DISPATCH_ARG_DIR},
+	{"resizewin", resizewin, DISPATCH_ARG_NUM_PAIR},
+	{"movewin", movewin, DISPATCH_ARG_NUM_PAIR},
+	{"toggle_named_scratchpad", toggle_named_scratchpad,
+	 DISPATCH_ARG_SCRATCHPAD},
+};
+
+/* 按名字哈希的开放寻址表,保存dispatchers的下标+1,0表示空槽 */
+#define DISPATCHER_TABLE_SIZE 256
+static unsigned char dispatcher_table[DISPATCHER_TABLE_SIZE];
+
+static uint32_t dispatcher_hash(const char *name) {
+	uint32_t hash = 2166136261u;
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool dispatcher_table_ready = false;
 
-	FuncType func = NULL;
+// 后台解析配置前需要在主线程先建好表
+void init_dispatcher_table(void) {
+	uint32_t i, slot;
+
+	if (dispatcher_table_ready)
+		return;
+
+	for (i = 0; i < LENGTH(dispatchers); i++) {
+		slot =
+			dispatcher_hash(dispatchers[i].name) & (DISPATCHER_TABLE_SIZE - 1);
+		while (dispatcher_table[slot])
+			slot = (slot + 1) & (DISPATCHER_TABLE_SIZE - 1);
+		dispatcher_table[slot] = i + 1;
+	}
+	dispatcher_table_ready = true;
+}
+
+const Dispatcher *find_dispatcher(const char *name) {
+	uint32_t slot;
+
+	if (!name)
+		return NULL;
+
+	init_dispatcher_table();
+
+	slot = dispatcher_hash(name) & (DISPATCHER_TABLE_SIZE - 1);
+	while (dispatcher_table[slot]) {
+		const Dispatcher *d = &dispatchers[dispatcher_table[slot] - 1];
+		if (strcmp(d->name, name) == 0)
+			return d;
+		slot = (slot + 1) & (DISPATCHER_TABLE_SIZE - 1);
+	}
+	return NULL;
+}
+
+// arena为NULL时参数字符串用strdup分配,由调用者释放
+static char *dispatch_arg_strdup(ConfigArena *arena, const char *str) {
+	return arena ? config_arena_strdup(arena, str) : strdup(str);
+}
+
+FuncType parse_func_name_in(ConfigArena *arena, char *func_name, Arg *arg,
+							char *arg_value, char *arg_value2,
+							char *arg_value3, char *arg_value4,
+							char *arg_value5) {
+
+	const Dispatcher *d;
 	(*arg).v = NULL;
 	(*arg).v2 = NULL;
 	(*arg).v3 = NULL;
 
-	if (strcmp(func_name, "focusstack") == 0) {
-		func = focusstack;
+	d = find_dispatcher(func_name);
+	if (!d)
+		return NULL;
+
+	switch (d->arg_type) {
+	case DISPATCH_ARG_CIRCLE_DIR:
 		(*arg).i = parse_circle_direction(arg_value);
-	} else if (strcmp(func_name, "focusdir") == 0) {
-		func = focusdir;
+		break;
+	case DISPATCH_ARG_DIR:
 		(*arg).i = parse_direction(arg_value);
-	} else if (strcmp(func_name, "incnmaster") == 0) {
-		func = incnmaster;
+		break;
+	case DISPATCH_ARG_INT:
 		(*arg).i = atoi(arg_value);
-	} else if (strcmp(func_name, "setmfact") == 0) {
-		func = setmfact;
-		(*arg).f = atof(arg_value);
-	} else if (strcmp(func_name, "setsmfact") == 0) {
-		func = setsmfact;
-		(*arg).f = atof(arg_value);
-	} else if (strcmp(func_name, "zoom") == 0) {
-		func = zoom;
-	} else if (strcmp(func_name, "exchange_client") == 0) {
-		func = exchange_client;
-		(*arg).i = parse_direction(arg_value);
-	} else if (strcmp(func_name, "toggleglobal") == 0) {
-		func = toggleglobal;
-	} else if (strcmp(func_name, "toggleoverview") == 0) {
-		func = toggleoverview;
-	} else if (strcmp(func_name, "set_proportion") == 0) {
-		func = set_proportion;
-		(*arg).f = atof(arg_value);
-	} else if (strcmp(func_name, "increase_proportion") == 0) {
-		func = increase_proportion;
+		break;
+	case DISPATCH_ARG_UINT:
+		(*arg).ui = atoi(arg_value);
+		break;
+	case DISPATCH_ARG_FLOAT:
 		(*arg).f = atof(arg_value);
-	} else if (strcmp(func_name, "switch_proportion_preset") == 0) {
-		func = switch_proportion_preset;
-	} else if (strcmp(func_name, "viewtoleft") == 0) {
-		func = viewtoleft;
-	} else if (strcmp(func_name, "viewtoright") == 0) {
-		func = viewtoright;
-	} else if (strcmp(func_name, "tagsilent") == 0) {
-		func = tagsilent;
+		break;
+	case DISPATCH_ARG_TAG:
 		(*arg).ui = 1 << (atoi(arg_value) - 1);
-	} else if (strcmp(func_name, "tagtoleft") == 0) {
-		func = tagtoleft;
-	} else if (strcmp(func_name, "tagtoright") == 0) {
-		func = tagtoright;
-	} else if (strcmp(func_name, "killclient") == 0) {
-		func = killclient;
-	} else if (strcmp(func_name, "focuslast") == 0) {
-		func = focuslast;
-	} else if (strcmp(func_name, "setlayout") == 0) {
-		func = setlayout;
-		(*arg).v = strdup(arg_value);
-	} else if (strcmp(func_name, "switch_layout") == 0) {
-		func = switch_layout;
-	} else if (strcmp(func_name, "switch_keyboard_layout") == 0) {
-		func = switch_keyboard_layout;
-	} else if (strcmp(func_name, "togglefloating") == 0) {
-		func = togglefloating;
-	} else if (strcmp(func_name, "togglefullscreen") == 0) {
-		func = togglefullscreen;
-	} else if (strcmp(func_name, "togglefakefullscreen") == 0) {
-		func = togglefakefullscreen;
-	} else if (strcmp(func_name, "toggleoverlay") == 0) {
-		func = toggleoverlay;
-	} else if (strcmp(func_name, "minized") == 0) {
-		func = minized;
-	} else if (strcmp(func_name, "restore_minized") == 0) {
-		func = restore_minized;
-	} else if (strcmp(func_name, "toggle_scratchpad") == 0) {
-		func = toggle_scratchpad;
-	} else if (strcmp(func_name, "toggle_render_border") == 0) {
-		func = toggle_render_border;
-	} else if (strcmp(func_name, "focusmon") == 0) {
-		func = focusmon;
+		break;
+	case DISPATCH_ARG_STRING:
+		(*arg).v = dispatch_arg_strdup(arena, arg_value);
+		break;
+	case DISPATCH_ARG_DIR_OR_NAME:
 		(*arg).i = parse_direction(arg_value);
 		if ((*arg).i == UNDIR) {
-			(*arg).v = strdup(arg_value);
+			(*arg).v = dispatch_arg_strdup(arena, arg_value);
 		}
-	} else if (strcmp(func_name, "tagmon") == 0) {
-		func = tagmon;
+		break;
+	case DISPATCH_ARG_DIR_UINT:
 		(*arg).i = parse_direction(arg_value);
 		(*arg).ui = atoi(arg_value2);
-	} else if (strcmp(func_name, "incgaps") == 0) {
-		func = incgaps;
-		(*arg).i = atoi(arg_value);
-	} else if (strcmp(func_name, "togglegaps") == 0) {
-		func = togglegaps;
-	} else if (strcmp(func_name, "chvt") == 0) {
-		func = chvt;
-		(*arg).ui = atoi(arg_value);
-	} else if (strcmp(func_name, "spawn") == 0) {
-		func = spawn;
-		(*arg).v = strdup(arg_value);
-	} else if (strcmp(func_name, "spawn_on_empty") == 0) {
-		func = spawn_on_empty;
-		(*arg).v = strdup(arg_value); // 注意：之后需要释放这个内存
+		break;
+	case DISPATCH_ARG_STRING_TAG:
+		(*arg).v = dispatch_arg_strdup(arena, arg_value);
 		(*arg).ui = 1 << (atoi(arg_value2) - 1);
-	} else if (strcmp(func_name, "quit") == 0) {
-		func = quit;
-	} else if (strcmp(func_name, "create_virtual_output") == 0) {
-		func = create_virtual_output;
-	} else if (strcmp(func_name, "destroy_all_virtual_output") == 0) {
-		func = destroy_all_virtual_output;
-	} else if (strcmp(func_name, "moveresize") == 0) {
-		func = moveresize;
+		break;
+	case DISPATCH_ARG_MOUSE_ACTION:
 		(*arg).ui = parse_mouse_action(arg_value);
-	} else if (strcmp(func_name, "togglemaxmizescreen") == 0) {
-		func = togglemaxmizescreen;
-	} else if (strcmp(func_name, "viewtoleft_have_client") == 0) {
-		func = viewtoleft_have_client;
-	} else if (strcmp(func_name, "viewtoright_have_client") == 0) {
-		func = viewtoright_have_client;
-	} else if (strcmp(func_name, "reload_config") == 0) {
-		func = reload_config;
-	} else if (strcmp(func_name, "tag") == 0) {
-		func = tag;
-		(*arg).ui = 1 << (atoi(arg_value) - 1);
-	} else if (strcmp(func_name, "view") == 0) {
-		func = bind_to_view;
-		(*arg).ui = 1 << (atoi(arg_value) - 1);
-	} else if (strcmp(func_name, "toggletag") == 0) {
-		func = toggletag;
-		(*arg).ui = 1 << (atoi(arg_value) - 1);
-	} else if (strcmp(func_name, "toggleview") == 0) {
-		func = toggleview;
-		(*arg).ui = 1 << (atoi(arg_value) - 1);
-	} else if (strcmp(func_name, "smartmovewin") == 0) {
-		func = smartmovewin;
-		(*arg).i = parse_direction(arg_value);
-	} else if (strcmp(func_name, "smartresizewin") == 0) {
-		func = smartresizewin;
-		(*arg).i = parse_direction(arg_value);
-	} else if (strcmp(func_name, "resizewin") == 0) {
-		func = resizewin;
-		(*arg).ui = parse_num_type(arg_value);
-		(*arg).ui2 = parse_num_type(arg_value2);
-		(*arg).i = (*arg).ui == NUM_TYPE_DEFAULT ? atoi(arg_value)
-												 : atoi(arg_value + 1);
-		(*arg).i2 = (*arg).ui2 == NUM_TYPE_DEFAULT ? atoi(arg_value2)
-												   : atoi(arg_value2 + 1);
-	} else if (strcmp(func_name, "movewin") == 0) {
-		func = movewin;
+		break;
+	case DISPATCH_ARG_NUM_PAIR:
 		(*arg).ui = parse_num_type(arg_value);
 		(*arg).ui2 = parse_num_type(arg_value2);
 		(*arg).i = (*arg).ui == NUM_TYPE_DEFAULT ? atoi(arg_value)
 												 : atoi(arg_value + 1);
 		(*arg).i2 = (*arg).ui2 == NUM_TYPE_DEFAULT ? atoi(arg_value2)
 												   : atoi(arg_value2 + 1);
-	} else if (strcmp(func_name, "toggle_named_scratchpad") == 0) {
-		func = toggle_named_scratchpad;
-		(*arg).v = strdup(arg_value);
-		(*arg).v2 = strdup(arg_value2);
-		(*arg).v3 = strdup(arg_value5);
+		break;
+	case DISPATCH_ARG_SCRATCHPAD:
+		(*arg).v = dispatch_arg_strdup(arena, arg_value);
+		(*arg).v2 = dispatch_arg_strdup(arena, arg_value2);
+		(*arg).v3 = dispatch_arg_strdup(arena, arg_value5);
 		(*arg).ui = arg_value3 ? atoi(arg_value3) : 0;
 		(*arg).ui2 = arg_value4 ? atoi(arg_value4) : 0;
-	} else {
-		return NULL;
+		break;
+	default:
+		break;
 	}
-	return func;
+	return d->func;
+}
+
+FuncType parse_func_name(char *func_name, Arg *arg, char *arg_value,
+						 char *arg_value2, char *arg_value3, char *arg_value4,
+						 char *arg_value5) {
+	return parse_func_name_in(NULL, func_name, arg, arg_value, arg_value2,
+							  arg_value3, arg_value4, arg_value5);
 }
 
 void run_exec() {
@@ -844,17 +1120,21 @@ void run_exec_once() {
 	}
 }
 
-void parse_config_line(Config *config, const char *line) {
-	char key[256], value[256];
+// 拆分出一行的键和值,不是key=value格式时返回false
+bool tokenize_config_line(const char *line, char *key, char *value) {
 	if (sscanf(line, "%[^=]=%[^\n]", key, value) != 2) {
 		// fprintf(stderr, "Error: Invalid line format: %s\n", line);
-		return;
+		return false;
 	}
 
 	// Then trim each part separately
 	trim_whitespace(key);
 	trim_whitespace(value);
+	return true;
+}
 
+// value会被部分配置项的解析修改
+void parse_config_entry(Config *config, const char *key, char *value) {
 	if (strcmp(key, "animations") == 0) {
 		config->animations = atoi(value);
 	} else if (strcmp(key, "layer_animations") == 0) {
@@ -972,12 +1252,30 @@ void parse_config_line(Config *config, const char *line) {
 		config->shadows_position_x = atoi(value);
 	} else if (strcmp(key, "shadows_position_y") == 0) {
 		config->shadows_position_y = atoi(value);
+	} else if (strcmp(key, "effect_governor") == 0) {
+		config->effect_governor = atoi(value);
+	} else if (strcmp(key, "effect_governor_budget") == 0) {
+		config->effect_governor_budget = atoi(value);
+	} else if (strcmp(key, "effect_governor_restore") == 0) {
+		config->effect_governor_restore = atoi(value);
+	} else if (strcmp(key, "effect_governor_frames") == 0) {
+		config->effect_governor_frames = atoi(value);
 	} else if (strcmp(key, "single_scratchpad") == 0) {
 		config->single_scratchpad = atoi(value);
 	} else if (strcmp(key, "xwayland_persistence") == 0) {
 		config->xwayland_persistence = atoi(value);
+	} else if (strcmp(key, "xwayland_lazy") == 0) {
+		config->xwayland_lazy = atoi(value);
+	} else if (strcmp(key, "xwayland_prewarm_delay") == 0) {
+		config->xwayland_prewarm_delay = atoi(value);
 	} else if (strcmp(key, "syncobj_enable") == 0) {
 		config->syncobj_enable = atoi(value);
+	} else if (strcmp(key, "allow_tearing") == 0) {
+		config->allow_tearing = atoi(value);
+	} else if (strcmp(key, "hidden_frame_rate") == 0) {
+		config->hidden_frame_rate = atoi(value);
+	} else if (strcmp(key, "asleep_frame_rate") == 0) {
+		config->asleep_frame_rate = atoi(value);
 	} else if (strcmp(key, "no_border_when_single") == 0) {
 		config->no_border_when_single = atoi(value);
 	} else if (strcmp(key, "no_radius_when_single") == 0) {
@@ -994,26 +1292,23 @@ void parse_config_line(Config *config, const char *line) {
 		config->focused_opacity = atof(value);
 	} else if (strcmp(key, "unfocused_opacity") == 0) {
 		config->unfocused_opacity = atof(value);
+	} else if (strcmp(key, "config_auto_reload") == 0) {
+		config->config_auto_reload = atoi(value);
 	} else if (strcmp(key, "xkb_rules_rules") == 0) {
-		strncpy(xkb_rules_rules, value, sizeof(xkb_rules_rules) - 1);
-		xkb_rules_rules[sizeof(xkb_rules_rules) - 1] =
-			'\0'; // 确保字符串以 null 结尾
+		snprintf(config->xkb_rules_rules, sizeof(config->xkb_rules_rules), "%s",
+				 value);
 	} else if (strcmp(key, "xkb_rules_model") == 0) {
-		strncpy(xkb_rules_model, value, sizeof(xkb_rules_model) - 1);
-		xkb_rules_model[sizeof(xkb_rules_model) - 1] =
-			'\0'; // 确保字符串以 null 结尾
+		snprintf(config->xkb_rules_model, sizeof(config->xkb_rules_model), "%s",
+				 value);
 	} else if (strcmp(key, "xkb_rules_layout") == 0) {
-		strncpy(xkb_rules_layout, value, sizeof(xkb_rules_layout) - 1);
-		xkb_rules_layout[sizeof(xkb_rules_layout) - 1] =
-			'\0'; // 确保字符串以 null 结尾
+		snprintf(config->xkb_rules_layout, sizeof(config->xkb_rules_layout),
+				 "%s", value);
 	} else if (strcmp(key, "xkb_rules_variant") == 0) {
-		strncpy(xkb_rules_variant, value, sizeof(xkb_rules_variant) - 1);
-		xkb_rules_variant[sizeof(xkb_rules_variant) - 1] =
-			'\0'; // 确保字符串以 null 结尾
+		snprintf(config->xkb_rules_variant, sizeof(config->xkb_rules_variant),
+				 "%s", value);
 	} else if (strcmp(key, "xkb_rules_options") == 0) {
-		strncpy(xkb_rules_options, value, sizeof(xkb_rules_options) - 1);
-		xkb_rules_options[sizeof(xkb_rules_options) - 1] =
-			'\0'; // 确保字符串以 null 结尾
+		snprintf(config->xkb_rules_options, sizeof(config->xkb_rules_options),
+				 "%s", value);
 	} else if (strcmp(key, "scroller_proportion_preset") == 0) {
 		// 1. 统计 value 中有多少个逗号，确定需要解析的浮点数个数
 		int count = 0; // 初始化为 0
@@ -1023,18 +1318,19 @@ void parse_config_line(Config *config, const char *line) {
 		}
 		int float_count = count + 1; // 浮点数的数量是逗号数量加 1
 
-		// 2. 动态分配内存，存储浮点数
-		config->scroller_proportion_preset =
-			(float *)malloc(float_count * sizeof(float));
+		// 2. 在arena中分配内存，存储浮点数
+		config->scroller_proportion_preset = config_arena_alloc(
+			&config->arena, float_count * sizeof(float));
 		if (!config->scroller_proportion_preset) {
 			fprintf(stderr, "Error: Memory allocation failed\n");
 			return;
 		}
 
 		// 3. 解析 value 中的浮点数
-		char *value_copy =
-			strdup(value); // 复制 value，因为 strtok 会修改原字符串
-		char *token = strtok(value_copy, ",");
+		char value_copy[256]; // 复制 value，因为 strtok 会修改原字符串
+		snprintf(value_copy, sizeof(value_copy), "%s", value);
+		char *saveptr;
+		char *token = strtok_r(value_copy, ",", &saveptr);
 		int i = 0;
 		float value_set;
 
@@ -1044,9 +1340,8 @@ void parse_config_line(Config *config, const char *line) {
 						"Error: Invalid float value in "
 						"scroller_proportion_preset: %s\n",
 						token);
-				free(value_copy);
-				free(config->scroller_proportion_preset);
 				config->scroller_proportion_preset = NULL;
+				config->scroller_proportion_preset_count = 0;
 				return;
 			}
 
@@ -1054,7 +1349,7 @@ void parse_config_line(Config *config, const char *line) {
 			config->scroller_proportion_preset[i] =
 				CLAMP_FLOAT(value_set, 0.1f, 1.0f);
 
-			token = strtok(NULL, ",");
+			token = strtok_r(NULL, ",", &saveptr);
 			i++;
 		}
 
@@ -1063,16 +1358,11 @@ void parse_config_line(Config *config, const char *line) {
 			fprintf(stderr,
 					"Error: Invalid scroller_proportion_preset format: %s\n",
 					value);
-			free(value_copy);
-			free(config->scroller_proportion_preset);  // 释放已分配的内存
-			config->scroller_proportion_preset = NULL; // 防止野指针
+			config->scroller_proportion_preset = NULL;
 			config->scroller_proportion_preset_count = 0;
 			return;
 		}
 		config->scroller_proportion_preset_count = float_count;
-
-		// 5. 释放临时复制的字符串
-		free(value_copy);
 	} else if (strcmp(key, "circle_layout") == 0) {
 		// 1. 统计 value 中有多少个逗号，确定需要解析的字符串个数
 		int count = 0; // 初始化为 0
@@ -1082,59 +1372,45 @@ void parse_config_line(Config *config, const char *line) {
 		}
 		int string_count = count + 1; // 字符串的数量是逗号数量加 1
 
-		// 2. 动态分配内存，存储字符串指针
-		config->circle_layout = (char **)malloc(string_count * sizeof(char *));
-		memset(config->circle_layout, 0, string_count * sizeof(char *));
+		// 2. 在arena中分配内存，存储字符串指针
+		config->circle_layout =
+			config_arena_alloc(&config->arena, string_count * sizeof(char *));
 		if (!config->circle_layout) {
 			fprintf(stderr, "Error: Memory allocation failed\n");
 			return;
 		}
 
 		// 3. 解析 value 中的字符串
-		char *value_copy =
-			strdup(value); // 复制 value，因为 strtok 会修改原字符串
-		char *token = strtok(value_copy, ",");
+		char value_copy[256]; // 复制 value，因为 strtok 会修改原字符串
+		snprintf(value_copy, sizeof(value_copy), "%s", value);
+		char *saveptr;
+		char *token = strtok_r(value_copy, ",", &saveptr);
 		int i = 0;
 		char *cleaned_token;
 		while (token != NULL && i < string_count) {
-			// 为每个字符串分配内存并复制内容
 			cleaned_token = sanitize_string(token);
-			config->circle_layout[i] = strdup(cleaned_token);
+			config->circle_layout[i] =
+				config_arena_strdup(&config->arena, cleaned_token);
 			if (!config->circle_layout[i]) {
 				fprintf(stderr,
 						"Error: Memory allocation failed for string: %s\n",
 						token);
-				// 释放之前分配的内存
-				for (int j = 0; j < i; j++) {
-					free(config->circle_layout[j]);
-				}
-				free(config->circle_layout);
-				free(value_copy);
-				config->circle_layout = NULL; // 防止野指针
+				config->circle_layout = NULL;
 				config->circle_layout_count = 0;
 				return;
 			}
-			token = strtok(NULL, ",");
+			token = strtok_r(NULL, ",", &saveptr);
 			i++;
 		}
 
 		// 4. 检查解析的字符串数量是否匹配
 		if (i != string_count) {
 			fprintf(stderr, "Error: Invalid circle_layout format: %s\n", value);
-			// 释放之前分配的内存
-			for (int j = 0; j < i; j++) {
-				free(config->circle_layout[j]);
-			}
-			free(config->circle_layout);
-			free(value_copy);
-			config->circle_layout = NULL; // 防止野指针
+			config->circle_layout = NULL;
 			config->circle_layout_count = 0;
 			return;
 		}
 		config->circle_layout_count = string_count;
-
-		// 5. 释放临时复制的字符串
-		free(value_copy);
 	} else if (strcmp(key, "new_is_master") == 0) {
 		config->new_is_master = atoi(value);
 	} else if (strcmp(key, "default_mfact") == 0) {
@@ -1149,6 +1425,8 @@ void parse_config_line(Config *config, const char *line) {
 		config->enable_hotarea = atoi(value);
 	} else if (strcmp(key, "ov_tab_mode") == 0) {
 		config->ov_tab_mode = atoi(value);
+	} else if (strcmp(key, "ov_scale_buffers") == 0) {
+		config->ov_scale_buffers = atoi(value);
 	} else if (strcmp(key, "overviewgappi") == 0) {
 		config->overviewgappi = atoi(value);
 	} else if (strcmp(key, "overviewgappo") == 0) {
@@ -1157,6 +1435,8 @@ void parse_config_line(Config *config, const char *line) {
 		config->cursor_hide_timeout = atoi(value);
 	} else if (strcmp(key, "axis_bind_apply_timeout") == 0) {
 		config->axis_bind_apply_timeout = atoi(value);
+	} else if (strcmp(key, "title_update_interval") == 0) {
+		config->title_update_interval = atoi(value);
 	} else if (strcmp(key, "focus_on_activate") == 0) {
 		config->focus_on_activate = atoi(value);
 	} else if (strcmp(key, "numlockon") == 0) {
@@ -1188,7 +1468,7 @@ void parse_config_line(Config *config, const char *line) {
 	} else if (strcmp(key, "cursor_size") == 0) {
 		config->cursor_size = atoi(value);
 	} else if (strcmp(key, "cursor_theme") == 0) {
-		config->cursor_theme = strdup(value);
+		config->cursor_theme = config_arena_strdup(&config->arena, value);
 	} else if (strcmp(key, "disable_while_typing") == 0) {
 		config->disable_while_typing = atoi(value);
 	} else if (strcmp(key, "left_handed") == 0) {
@@ -1298,10 +1578,7 @@ void parse_config_line(Config *config, const char *line) {
 		trim_whitespace(config->autostart[1]);
 		trim_whitespace(config->autostart[2]);
 	} else if (strcmp(key, "tagrule") == 0) {
-		config->tag_rules =
-			realloc(config->tag_rules,
-					(config->tag_rules_count + 1) * sizeof(ConfigTagRule));
-		if (!config->tag_rules) {
+		if (!CONFIG_ARRAY_RESERVE(config, tag_rules)) {
 			fprintf(stderr, "Error: Failed to allocate memory for tag rules\n");
 			return;
 		}
@@ -1314,7 +1591,8 @@ void parse_config_line(Config *config, const char *line) {
 		rule->layout_name = NULL;
 		rule->monitor_name = NULL;
 
-		char *token = strtok(value, ",");
+		char *saveptr;
+		char *token = strtok_r(value, ",", &saveptr);
 		while (token != NULL) {
 			char *colon = strchr(token, ':');
 			if (colon != NULL) {
@@ -1328,22 +1606,21 @@ void parse_config_line(Config *config, const char *line) {
 				if (strcmp(key, "id") == 0) {
 					rule->id = CLAMP_INT(atoi(val), 1, LENGTH(tags));
 				} else if (strcmp(key, "layout_name") == 0) {
-					rule->layout_name = strdup(val);
+					rule->layout_name =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "monitor_name") == 0) {
-					rule->monitor_name = strdup(val);
+					rule->monitor_name =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "no_render_border") == 0) {
 					rule->no_render_border = CLAMP_INT(atoi(val), 0, 1);
 				}
 			}
-			token = strtok(NULL, ",");
+			token = strtok_r(NULL, ",", &saveptr);
 		}
 
 		config->tag_rules_count++;
 	} else if (strcmp(key, "layerrule") == 0) {
-		config->layer_rules =
-			realloc(config->layer_rules,
-					(config->layer_rules_count + 1) * sizeof(ConfigLayerRule));
-		if (!config->layer_rules) {
+		if (!CONFIG_ARRAY_RESERVE(config, layer_rules)) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for layer rules\n");
 			return;
@@ -1360,7 +1637,8 @@ void parse_config_line(Config *config, const char *line) {
 		rule->noanim = 0;
 		rule->noshadow = 0;
 
-		char *token = strtok(value, ",");
+		char *saveptr;
+		char *token = strtok_r(value, ",", &saveptr);
 		while (token != NULL) {
 			char *colon = strchr(token, ':');
 			if (colon != NULL) {
@@ -1372,11 +1650,14 @@ void parse_config_line(Config *config, const char *line) {
 				trim_whitespace(val);
 
 				if (strcmp(key, "layer_name") == 0) {
-					rule->layer_name = strdup(val);
+					rule->layer_name =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "animation_type_open") == 0) {
-					rule->animation_type_open = strdup(val);
+					rule->animation_type_open =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "animation_type_close") == 0) {
-					rule->animation_type_close = strdup(val);
+					rule->animation_type_close =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "noblur") == 0) {
 					rule->noblur = CLAMP_INT(atoi(val), 0, 1);
 				} else if (strcmp(key, "noanim") == 0) {
@@ -1385,20 +1666,18 @@ void parse_config_line(Config *config, const char *line) {
 					rule->noshadow = CLAMP_INT(atoi(val), 0, 1);
 				}
 			}
-			token = strtok(NULL, ",");
+			token = strtok_r(NULL, ",", &saveptr);
 		}
 
 		// 如果没有指定布局名称，则使用默认值
 		if (rule->layer_name == NULL) {
-			rule->layer_name = strdup("default");
+			rule->layer_name =
+				config_arena_strdup(&config->arena, "default");
 		}
 
 		config->layer_rules_count++;
 	} else if (strcmp(key, "windowrule") == 0) {
-		config->window_rules =
-			realloc(config->window_rules,
-					(config->window_rules_count + 1) * sizeof(ConfigWinRule));
-		if (!config->window_rules) {
+		if (!CONFIG_ARRAY_RESERVE(config, window_rules)) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for window rules\n");
 			return;
@@ -1418,6 +1697,8 @@ void parse_config_line(Config *config, const char *line) {
 		rule->isterm = -1;
 		rule->noswallow = -1;
 		rule->noblur = -1;
+		rule->allow_tearing = -1;
+		rule->hidden_frame_rate = -1;
 		rule->monitor = NULL;
 		rule->offsetx = 0;
 		rule->offsety = 0;
@@ -1438,7 +1719,8 @@ void parse_config_line(Config *config, const char *line) {
 		rule->tags = 0;
 		rule->globalkeybinding = (KeyBinding){0};
 
-		char *token = strtok(value, ",");
+		char *saveptr;
+		char *token = strtok_r(value, ",", &saveptr);
 		while (token != NULL) {
 			char *colon = strchr(token, ':');
 			if (colon != NULL) {
@@ -1452,17 +1734,22 @@ void parse_config_line(Config *config, const char *line) {
 				if (strcmp(key, "isfloating") == 0) {
 					rule->isfloating = atoi(val);
 				} else if (strcmp(key, "title") == 0) {
-					rule->title = strdup(val);
+					rule->title =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "appid") == 0) {
-					rule->id = strdup(val);
+					rule->id =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "animation_type_open") == 0) {
-					rule->animation_type_open = strdup(val);
+					rule->animation_type_open =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "animation_type_close") == 0) {
-					rule->animation_type_close = strdup(val);
+					rule->animation_type_close =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "tags") == 0) {
 					rule->tags = 1 << (atoi(val) - 1);
 				} else if (strcmp(key, "monitor") == 0) {
-					rule->monitor = strdup(val);
+					rule->monitor =
+						config_arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "offsetx") == 0) {
 					rule->offsetx = atoi(val);
 				} else if (strcmp(key, "offsety") == 0) {
@@ -1503,6 +1790,10 @@ void parse_config_line(Config *config, const char *line) {
 					rule->noswallow = atoi(val);
 				} else if (strcmp(key, "noblur") == 0) {
 					rule->noblur = atoi(val);
+				} else if (strcmp(key, "allow_tearing") == 0) {
+					rule->allow_tearing = CLAMP_INT(atoi(val), 0, 2);
+				} else if (strcmp(key, "hidden_frame_rate") == 0) {
+					rule->hidden_frame_rate = CLAMP_INT(atoi(val), 0, 240);
 				} else if (strcmp(key, "scroller_proportion") == 0) {
 					rule->scroller_proportion = atof(val);
 				} else if (strcmp(key, "isfullscreen") == 0) {
@@ -1516,14 +1807,11 @@ void parse_config_line(Config *config, const char *line) {
 					rule->globalkeybinding.keysymcode = parse_key(keysym_str);
 				}
 			}
-			token = strtok(NULL, ",");
+			token = strtok_r(NULL, ",", &saveptr);
 		}
 		config->window_rules_count++;
 	} else if (strcmp(key, "monitorrule") == 0) {
-		config->monitor_rules =
-			realloc(config->monitor_rules, (config->monitor_rules_count + 1) *
-											   sizeof(ConfigMonitorRule));
-		if (!config->monitor_rules) {
+		if (!CONFIG_ARRAY_RESERVE(config, monitor_rules)) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for monitor rules\n");
 			return;
@@ -1562,8 +1850,8 @@ void parse_config_line(Config *config, const char *line) {
 			trim_whitespace(raw_refresh);
 
 			// 转换修剪后的字符串为特定类型
-			rule->name = strdup(raw_name);
-			rule->layout = strdup(raw_layout);
+			rule->name = config_arena_strdup(&config->arena, raw_name);
+			rule->layout = config_arena_strdup(&config->arena, raw_layout);
 			rule->mfact = atof(raw_mfact);
 			rule->nmaster = atoi(raw_nmaster);
 			rule->rr = atoi(raw_rr);
@@ -1575,10 +1863,6 @@ void parse_config_line(Config *config, const char *line) {
 			rule->refresh = atof(raw_refresh);
 
 			if (!rule->name || !rule->layout) {
-				if (rule->name)
-					free((void *)rule->name);
-				if (rule->layout)
-					free((void *)rule->layout);
 				fprintf(stderr,
 						"Error: Failed to allocate memory for monitor rule\n");
 				return;
@@ -1597,18 +1881,26 @@ void parse_config_line(Config *config, const char *line) {
 		}
 		trim_whitespace(env_type);
 		trim_whitespace(env_value);
-		setenv(env_type, env_value, 1);
+		if (!CONFIG_ARRAY_RESERVE(config, env)) {
+			fprintf(stderr, "Error: Failed to allocate memory for env\n");
+			return;
+		}
+		config->env[config->env_count].name =
+			config_arena_strdup(&config->arena, env_type);
+		config->env[config->env_count].value =
+			config_arena_strdup(&config->arena, env_value);
+		if (config->env[config->env_count].name &&
+			config->env[config->env_count].value)
+			config->env_count++;
 
 	} else if (strncmp(key, "exec", 9) == 0) {
-		char **new_exec =
-			realloc(config->exec, (config->exec_count + 1) * sizeof(char *));
-		if (!new_exec) {
+		if (!CONFIG_ARRAY_RESERVE(config, exec)) {
 			fprintf(stderr, "Error: Failed to allocate memory for exec\n");
 			return;
 		}
-		config->exec = new_exec;
 
-		config->exec[config->exec_count] = strdup(value);
+		config->exec[config->exec_count] =
+			config_arena_strdup(&config->arena, value);
 		if (!config->exec[config->exec_count]) {
 			fprintf(stderr, "Error: Failed to duplicate exec string\n");
 			return;
@@ -1618,15 +1910,13 @@ void parse_config_line(Config *config, const char *line) {
 
 	} else if (strncmp(key, "exec-once", 9) == 0) {
 
-		char **new_exec_once = realloc(
-			config->exec_once, (config->exec_once_count + 1) * sizeof(char *));
-		if (!new_exec_once) {
+		if (!CONFIG_ARRAY_RESERVE(config, exec_once)) {
 			fprintf(stderr, "Error: Failed to allocate memory for exec_once\n");
 			return;
 		}
-		config->exec_once = new_exec_once;
 
-		config->exec_once[config->exec_once_count] = strdup(value);
+		config->exec_once[config->exec_once_count] =
+			config_arena_strdup(&config->arena, value);
 		if (!config->exec_once[config->exec_once_count]) {
 			fprintf(stderr, "Error: Failed to duplicate exec_once string\n");
 			return;
@@ -1635,10 +1925,7 @@ void parse_config_line(Config *config, const char *line) {
 		config->exec_once_count++;
 
 	} else if (strncmp(key, "bind", 4) == 0) {
-		config->key_bindings =
-			realloc(config->key_bindings,
-					(config->key_bindings_count + 1) * sizeof(KeyBinding));
-		if (!config->key_bindings) {
+		if (!CONFIG_ARRAY_RESERVE(config, key_bindings)) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for key bindings\n");
 			return;
@@ -1672,31 +1959,17 @@ void parse_config_line(Config *config, const char *line) {
 		binding->arg.v2 = NULL;
 		binding->arg.v3 = NULL;
 		binding->func =
-			parse_func_name(func_name, &binding->arg, arg_value, arg_value2,
-							arg_value3, arg_value4, arg_value5);
+			parse_func_name_in(&config->arena, func_name, &binding->arg,
+							   arg_value, arg_value2, arg_value3, arg_value4,
+							   arg_value5);
 		if (!binding->func) {
-			if (binding->arg.v) {
-				free(binding->arg.v);
-				binding->arg.v = NULL;
-			}
-			if (binding->arg.v2) {
-				free(binding->arg.v2);
-				binding->arg.v2 = NULL;
-			}
-			if (binding->arg.v3) {
-				free(binding->arg.v3);
-				binding->arg.v3 = NULL;
-			}
 			fprintf(stderr, "Error: Unknown function in bind: %s\n", func_name);
 		} else {
 			config->key_bindings_count++;
 		}
 
 	} else if (strncmp(key, "mousebind", 9) == 0) {
-		config->mouse_bindings =
-			realloc(config->mouse_bindings,
-					(config->mouse_bindings_count + 1) * sizeof(MouseBinding));
-		if (!config->mouse_bindings) {
+		if (!CONFIG_ARRAY_RESERVE(config, mouse_bindings)) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for mouse bindings\n");
 			return;
@@ -1731,31 +2004,17 @@ void parse_config_line(Config *config, const char *line) {
 		binding->arg.v2 = NULL;
 		binding->arg.v3 = NULL;
 		binding->func =
-			parse_func_name(func_name, &binding->arg, arg_value, arg_value2,
-							arg_value3, arg_value4, arg_value5);
+			parse_func_name_in(&config->arena, func_name, &binding->arg,
+							   arg_value, arg_value2, arg_value3, arg_value4,
+							   arg_value5);
 		if (!binding->func) {
-			if (binding->arg.v) {
-				free(binding->arg.v);
-				binding->arg.v = NULL;
-			}
-			if (binding->arg.v2) {
-				free(binding->arg.v2);
-				binding->arg.v2 = NULL;
-			}
-			if (binding->arg.v3) {
-				free(binding->arg.v3);
-				binding->arg.v3 = NULL;
-			}
 			fprintf(stderr, "Error: Unknown function in mousebind: %s\n",
 					func_name);
 		} else {
 			config->mouse_bindings_count++;
 		}
 	} else if (strncmp(key, "axisbind", 8) == 0) {
-		config->axis_bindings =
-			realloc(config->axis_bindings,
-					(config->axis_bindings_count + 1) * sizeof(AxisBinding));
-		if (!config->axis_bindings) {
+		if (!CONFIG_ARRAY_RESERVE(config, axis_bindings)) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for axis bindings\n");
 			return;
@@ -1791,22 +2050,11 @@ void parse_config_line(Config *config, const char *line) {
 		binding->arg.v2 = NULL;
 		binding->arg.v3 = NULL;
 		binding->func =
-			parse_func_name(func_name, &binding->arg, arg_value, arg_value2,
-							arg_value3, arg_value4, arg_value5);
+			parse_func_name_in(&config->arena, func_name, &binding->arg,
+							   arg_value, arg_value2, arg_value3, arg_value4,
+							   arg_value5);
 
 		if (!binding->func) {
-			if (binding->arg.v) {
-				free(binding->arg.v);
-				binding->arg.v = NULL;
-			}
-			if (binding->arg.v2) {
-				free(binding->arg.v2);
-				binding->arg.v2 = NULL;
-			}
-			if (binding->arg.v3) {
-				free(binding->arg.v3);
-				binding->arg.v3 = NULL;
-			}
 			fprintf(stderr, "Error: Unknown function in axisbind: %s\n",
 					func_name);
 		} else {
@@ -1814,10 +2062,7 @@ void parse_config_line(Config *config, const char *line) {
 		}
 
 	} else if (strncmp(key, "gesturebind", 11) == 0) {
-		config->gesture_bindings = realloc(
-			config->gesture_bindings,
-			(config->gesture_bindings_count + 1) * sizeof(GestureBinding));
-		if (!config->gesture_bindings) {
+		if (!CONFIG_ARRAY_RESERVE(config, gesture_bindings)) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for axis gesturebind\n");
 			return;
@@ -1856,22 +2101,11 @@ void parse_config_line(Config *config, const char *line) {
 		binding->arg.v2 = NULL;
 		binding->arg.v3 = NULL;
 		binding->func =
-			parse_func_name(func_name, &binding->arg, arg_value, arg_value2,
-							arg_value3, arg_value4, arg_value5);
+			parse_func_name_in(&config->arena, func_name, &binding->arg,
+							   arg_value, arg_value2, arg_value3, arg_value4,
+							   arg_value5);
 
 		if (!binding->func) {
-			if (binding->arg.v) {
-				free(binding->arg.v);
-				binding->arg.v = NULL;
-			}
-			if (binding->arg.v2) {
-				free(binding->arg.v2);
-				binding->arg.v2 = NULL;
-			}
-			if (binding->arg.v3) {
-				free(binding->arg.v3);
-				binding->arg.v3 = NULL;
-			}
 			fprintf(stderr, "Error: Unknown function in axisbind: %s\n",
 					func_name);
 		} else {
@@ -1885,269 +2119,208 @@ void parse_config_line(Config *config, const char *line) {
 	}
 }
 
-void parse_config_file(Config *config, const char *file_path) {
-	FILE *file;
-	// 检查路径是否以 ~/ 开头
-	if (file_path[0] == '~' && (file_path[1] == '/' || file_path[1] == '\0')) {
-		const char *home = getenv("HOME");
-		if (!home) {
-			fprintf(stderr, "Error: HOME environment variable not set.\n");
-			return;
-		}
+/* 每个配置文件拆分好的键值对按路径缓存,文件没变时重载直接重放,
+ * 不再读文件和分词. 同一时间只有一个线程在解析配置,不需要加锁 */
+typedef struct ConfigUnit {
+	struct ConfigUnit *next;
+	char *path;
+	FileStamp stamp;
+	char *entries; // 依次存放 key\0value\0
+	size_t len;
+	unsigned int parse_id; // 最近一次被使用的解析
+} ConfigUnit;
+
+static ConfigUnit *config_units;
+static unsigned int config_unit_parse_id;
+static unsigned int config_units_read, config_units_reused;
+
+static void config_unit_free(ConfigUnit *unit) {
+	free(unit->path);
+	free(unit->entries);
+	free(unit);
+}
 
-		// 构建完整路径（家目录 + / + 原路径去掉 ~）
-		char full_path[1024];
-		snprintf(full_path, sizeof(full_path), "%s%s", home, file_path + 1);
+static bool config_unit_append(ConfigUnit *unit, size_t *cap, const char *key,
+							   const char *value) {
+	size_t key_len = strlen(key) + 1, value_len = strlen(value) + 1;
+	char *entries;
 
-		file = fopen(full_path, "r");
-		if (!file) {
-			perror("Error opening file");
-			return;
-		}
-	} else {
-		file = fopen(file_path, "r");
-		if (!file) {
-			perror("Error opening file");
-			return;
-		}
+	if (unit->len + key_len + value_len > *cap) {
+		size_t new_cap = *cap ? *cap : 4096;
+		while (new_cap < unit->len + key_len + value_len)
+			new_cap *= 2;
+		if (!(entries = realloc(unit->entries, new_cap)))
+			return false;
+		unit->entries = entries;
+		*cap = new_cap;
+	}
+	memcpy(unit->entries + unit->len, key, key_len);
+	memcpy(unit->entries + unit->len + key_len, value, value_len);
+	unit->len += key_len + value_len;
+	return true;
+}
+
+// 读文件并分词,失败时返回NULL
+static ConfigUnit *config_unit_read(const char *path, const FileStamp *stamp) {
+	char line[512], key[256], value[256];
+	ConfigUnit *unit;
+	size_t cap = 0;
+	FILE *file;
+
+	if (!(file = fopen(path, "r"))) {
+		perror("Error opening file");
+		return NULL;
 	}
 
-	char line[512];
-	while (fgets(line, sizeof(line), file)) {
+	unit = ecalloc(1, sizeof(*unit));
+	unit->path = strdup(path);
+	unit->stamp = *stamp;
+	while (unit->path && fgets(line, sizeof(line), file)) {
 		if (line[0] == '#' || line[0] == '\n')
 			continue;
-		parse_config_line(config, line);
+		if (tokenize_config_line(line, key, value) &&
+			!config_unit_append(unit, &cap, key, value)) {
+			free(unit->path);
+			unit->path = NULL;
+		}
 	}
-
 	fclose(file);
-}
 
-void free_circle_layout(Config *config) {
-	if (config->circle_layout) {
-		// 释放每个字符串
-		for (int i = 0; i < config->circle_layout_count; i++) {
-			if (config->circle_layout[i]) {
-				free(config->circle_layout[i]);	 // 释放单个字符串
-				config->circle_layout[i] = NULL; // 防止野指针
-			}
-		}
-		// 释放 circle_layout 数组本身
-		free(config->circle_layout);
-		config->circle_layout = NULL; // 防止野指针
+	if (!unit->path) {
+		config_unit_free(unit);
+		return NULL;
 	}
-	config->circle_layout_count = 0; // 重置计数
+	return unit;
 }
 
-void free_baked_points(void) {
-	if (baked_points_move) {
-		free(baked_points_move);
-		baked_points_move = NULL;
-	}
-	if (baked_points_open) {
-		free(baked_points_open);
-		baked_points_open = NULL;
-	}
-	if (baked_points_close) {
-		free(baked_points_close);
-		baked_points_close = NULL;
+// 取文件的解析单元,文件变化过就重新读取
+static ConfigUnit *config_unit_get(const char *path, const FileStamp *stamp) {
+	ConfigUnit **link, *unit;
+
+	for (link = &config_units; *link; link = &(*link)->next) {
+		if (strcmp((*link)->path, path) == 0)
+			break;
 	}
-	if (baked_points_tag) {
-		free(baked_points_tag);
-		baked_points_tag = NULL;
+
+	if (*link && file_stamp_equal(&(*link)->stamp, stamp)) {
+		unit = *link;
+		config_units_reused++;
+	} else {
+		if (!(unit = config_unit_read(path, stamp)))
+			return NULL;
+		config_units_read++;
+		if (*link) {
+			unit->next = (*link)->next;
+			config_unit_free(*link);
+		}
+		*link = unit;
 	}
+	unit->parse_id = config_unit_parse_id;
+	return unit;
 }
 
-void free_config(void) {
-	// 释放内存
-	int i;
+static void config_unit_apply(Config *config, const ConfigUnit *unit) {
+	char value[256];
+	const char *key;
 
-	// 释放 window_rules
-	if (config.window_rules) {
-		for (int i = 0; i < config.window_rules_count; i++) {
-			ConfigWinRule *rule = &config.window_rules[i];
-			if (rule->id)
-				free((void *)rule->id);
-			if (rule->title)
-				free((void *)rule->title);
-			if (rule->animation_type_open)
-				free((void *)rule->animation_type_open);
-			if (rule->animation_type_close)
-				free((void *)rule->animation_type_close);
-			if (rule->monitor)
-				free((void *)rule->monitor);
-			rule->id = NULL;
-			rule->title = NULL;
-			rule->animation_type_open = NULL;
-			rule->animation_type_close = NULL;
-			rule->monitor = NULL;
-			// 释放 globalkeybinding 的 arg.v（如果动态分配）
-			if (rule->globalkeybinding.arg.v) {
-				free((void *)rule->globalkeybinding.arg.v);
-			}
-		}
-		free(config.window_rules);
-		config.window_rules = NULL;
-		config.window_rules_count = 0;
+	for (size_t pos = 0; pos < unit->len;) {
+		key = unit->entries + pos;
+		pos += strlen(key) + 1;
+		snprintf(value, sizeof(value), "%s", unit->entries + pos);
+		pos += strlen(unit->entries + pos) + 1;
+		parse_config_entry(config, key, value);
 	}
+}
 
-	// 释放 monitor_rules
-	if (config.monitor_rules) {
-		for (int i = 0; i < config.monitor_rules_count; i++) {
-			ConfigMonitorRule *rule = &config.monitor_rules[i];
-			free((void *)rule->name);
-			free((void *)rule->layout);
-		}
-		free(config.monitor_rules);
-		config.monitor_rules = NULL;
-		config.monitor_rules_count = 0;
-	}
+void config_units_begin(void) {
+	config_unit_parse_id++;
+	config_units_read = config_units_reused = 0;
+}
 
-	// 释放 key_bindings
-	if (config.key_bindings) {
-		for (i = 0; i < config.key_bindings_count; i++) {
-			if (config.key_bindings[i].arg.v) {
-				free((void *)config.key_bindings[i].arg.v);
-				config.key_bindings[i].arg.v = NULL;
-			}
-			if (config.key_bindings[i].arg.v2) {
-				free((void *)config.key_bindings[i].arg.v2);
-				config.key_bindings[i].arg.v2 = NULL;
-			}
-			if (config.key_bindings[i].arg.v3) {
-				free((void *)config.key_bindings[i].arg.v3);
-				config.key_bindings[i].arg.v3 = NULL;
-			}
-		}
-		free(config.key_bindings);
-		config.key_bindings = NULL;
-		config.key_bindings_count = 0;
-	}
+// 一次完整解析后丢掉不再被引用的文件
+void config_units_end(void) {
+	ConfigUnit **link = &config_units, *unit;
 
-	// 释放 mouse_bindings
-	if (config.mouse_bindings) {
-		for (i = 0; i < config.mouse_bindings_count; i++) {
-			if (config.mouse_bindings[i].arg.v) {
-				free((void *)config.mouse_bindings[i].arg.v);
-				config.mouse_bindings[i].arg.v = NULL;
-			}
-			if (config.mouse_bindings[i].arg.v2) {
-				free((void *)config.mouse_bindings[i].arg.v2);
-				config.mouse_bindings[i].arg.v2 = NULL;
-			}
-			if (config.mouse_bindings[i].arg.v3) {
-				free((void *)config.mouse_bindings[i].arg.v3);
-				config.mouse_bindings[i].arg.v3 = NULL;
-			}
+	while ((unit = *link)) {
+		if (unit->parse_id != config_unit_parse_id) {
+			*link = unit->next;
+			config_unit_free(unit);
+		} else {
+			link = &unit->next;
 		}
-		free(config.mouse_bindings);
-		config.mouse_bindings = NULL;
-		config.mouse_bindings_count = 0;
 	}
+	wlr_log(WLR_DEBUG, "config parse: %u files read, %u reused",
+			config_units_read, config_units_reused);
+}
 
-	// 释放 axis_bindings
-	if (config.axis_bindings) {
-		for (i = 0; i < config.axis_bindings_count; i++) {
-			if (config.axis_bindings[i].arg.v) {
-				free((void *)config.axis_bindings[i].arg.v);
-				config.axis_bindings[i].arg.v = NULL;
-			}
-			if (config.axis_bindings[i].arg.v2) {
-				free((void *)config.axis_bindings[i].arg.v2);
-				config.axis_bindings[i].arg.v2 = NULL;
-			}
-			if (config.axis_bindings[i].arg.v3) {
-				free((void *)config.axis_bindings[i].arg.v3);
-				config.axis_bindings[i].arg.v3 = NULL;
-			}
-		}
-		free(config.axis_bindings);
-		config.axis_bindings = NULL;
-		config.axis_bindings_count = 0;
-	}
+void config_units_free(void) {
+	ConfigUnit *unit;
 
-	// 释放 gesture_bindings
-	if (config.gesture_bindings) {
-		for (i = 0; i < config.gesture_bindings_count; i++) {
-			if (config.gesture_bindings[i].arg.v) {
-				free((void *)config.gesture_bindings[i].arg.v);
-				config.gesture_bindings[i].arg.v = NULL;
-			}
-			if (config.gesture_bindings[i].arg.v2) {
-				free((void *)config.gesture_bindings[i].arg.v2);
-				config.gesture_bindings[i].arg.v2 = NULL;
-			}
-			if (config.gesture_bindings[i].arg.v3) {
-				free((void *)config.gesture_bindings[i].arg.v3);
-				config.gesture_bindings[i].arg.v3 = NULL;
-			}
-		}
-		free(config.gesture_bindings);
-		config.gesture_bindings = NULL;
-		config.gesture_bindings_count = 0;
+	while ((unit = config_units)) {
+		config_units = unit->next;
+		config_unit_free(unit);
 	}
+}
 
-	// 释放 tag_rules
-	if (config.tag_rules) {
-		for (int i = 0; i < config.tag_rules_count; i++) {
-			if (config.tag_rules[i].layout_name)
-				free((void *)config.tag_rules[i].layout_name);
-			if (config.tag_rules[i].monitor_name)
-				free((void *)config.tag_rules[i].monitor_name);
-		}
-		free(config.tag_rules);
-		config.tag_rules = NULL;
-		config.tag_rules_count = 0;
-	}
+// 记录读取过的文件,配置缓存据此判断是否需要重新解析
+void config_record_file(Config *config, const char *path, FileStamp *stamp) {
+	ConfigFile *file;
 
-	// 释放 layer_rules
-	if (config.layer_rules) {
-		for (int i = 0; i < config.layer_rules_count; i++) {
-			if (config.layer_rules[i].layer_name)
-				free((void *)config.layer_rules[i].layer_name);
-			if (config.layer_rules[i].animation_type_open)
-				free((void *)config.layer_rules[i].animation_type_open);
-			if (config.layer_rules[i].animation_type_close)
-				free((void *)config.layer_rules[i].animation_type_close);
-		}
-		free(config.layer_rules);
-		config.layer_rules = NULL;
-		config.layer_rules_count = 0;
-	}
+	file_stamp_get(path, stamp);
+	if (!CONFIG_ARRAY_RESERVE(config, files))
+		return;
+	file = &config->files[config->files_count];
+	file->stamp = *stamp;
+	if ((file->path = config_arena_strdup(&config->arena, path)))
+		config->files_count++;
+}
 
-	// 释放 exec
-	if (config.exec) {
-		for (i = 0; i < config.exec_count; i++) {
-			free(config.exec[i]);
+void parse_config_file(Config *config, const char *file_path) {
+	ConfigUnit *unit;
+	FileStamp stamp;
+	char full_path[1024];
+	// 检查路径是否以 ~/ 开头
+	if (file_path[0] == '~' && (file_path[1] == '/' || file_path[1] == '\0')) {
+		const char *home = getenv("HOME");
+		if (!home) {
+			fprintf(stderr, "Error: HOME environment variable not set.\n");
+			return;
 		}
-		free(config.exec);
-		config.exec = NULL;
-		config.exec_count = 0;
-	}
 
-	// 释放 exec_once
-	if (config.exec_once) {
-		for (i = 0; i < config.exec_once_count; i++) {
-			free(config.exec_once[i]);
-		}
-		free(config.exec_once);
-		config.exec_once = NULL;
-		config.exec_once_count = 0;
+		// 构建完整路径（家目录 + / + 原路径去掉 ~）
+		snprintf(full_path, sizeof(full_path), "%s%s", home, file_path + 1);
+	} else {
+		snprintf(full_path, sizeof(full_path), "%s", file_path);
 	}
 
-	// 释放 scroller_proportion_preset
-	if (config.scroller_proportion_preset) {
-		free(config.scroller_proportion_preset);
-		config.scroller_proportion_preset = NULL;
-		config.scroller_proportion_preset_count = 0;
-	}
+	config_record_file(config, full_path, &stamp);
+	if ((unit = config_unit_get(full_path, &stamp)))
+		config_unit_apply(config, unit);
+}
 
-	if (config.cursor_theme) {
-		free(config.cursor_theme);
-		config.cursor_theme = NULL;
+void free_baked_points(void) {
+	if (baked_points_move) {
+		free(baked_points_move);
+		baked_points_move = NULL;
+	}
+	if (baked_points_open) {
+		free(baked_points_open);
+		baked_points_open = NULL;
+	}
+	if (baked_points_close) {
+		free(baked_points_close);
+		baked_points_close = NULL;
 	}
+	if (baked_points_tag) {
+		free(baked_points_tag);
+		baked_points_tag = NULL;
+	}
+}
 
-	// 释放 circle_layout
-	free_circle_layout(&config);
+void free_config(void) {
+	// 所有配置数据都在arena中,整块释放即可
+	config_arena_release(&config.arena);
+	config_units_free();
 
 	// 释放动画资源
 	free_baked_points();
@@ -2206,14 +2379,21 @@ void override_config(void) {
 	hotarea_size = CLAMP_INT(config.hotarea_size, 1, 1000);
 	enable_hotarea = CLAMP_INT(config.enable_hotarea, 0, 1);
 	ov_tab_mode = CLAMP_INT(config.ov_tab_mode, 0, 1);
+	ov_scale_buffers = CLAMP_INT(config.ov_scale_buffers, 0, 1);
 	overviewgappi = CLAMP_INT(config.overviewgappi, 0, 1000);
 	overviewgappo = CLAMP_INT(config.overviewgappo, 0, 1000);
 
 	// 杂项设置
 	xwayland_persistence = CLAMP_INT(config.xwayland_persistence, 0, 1);
+	xwayland_lazy = CLAMP_INT(config.xwayland_lazy, 0, 1);
+	xwayland_prewarm_delay = CLAMP_INT(config.xwayland_prewarm_delay, 0, 3600);
 	syncobj_enable = CLAMP_INT(config.syncobj_enable, 0, 1);
+	allow_tearing = CLAMP_INT(config.allow_tearing, 0, 2);
+	hidden_frame_rate = CLAMP_INT(config.hidden_frame_rate, 0, 240);
+	asleep_frame_rate = CLAMP_INT(config.asleep_frame_rate, 0, 240);
 	axis_bind_apply_timeout =
 		CLAMP_INT(config.axis_bind_apply_timeout, 0, 1000);
+	title_update_interval = CLAMP_INT(config.title_update_interval, 0, 10000);
 	focus_on_activate = CLAMP_INT(config.focus_on_activate, 0, 1);
 	inhibit_regardless_of_visibility =
 		CLAMP_INT(config.inhibit_regardless_of_visibility, 0, 1);
@@ -2290,6 +2470,27 @@ void override_config(void) {
 	focused_opacity = CLAMP_FLOAT(config.focused_opacity, 0.0f, 1.0f);
 	unfocused_opacity = CLAMP_FLOAT(config.unfocused_opacity, 0.0f, 1.0f);
 	memcpy(shadowscolor, config.shadowscolor, sizeof(shadowscolor));
+	effect_governor = CLAMP_INT(config.effect_governor, 0, 1);
+	effect_governor_budget = CLAMP_INT(config.effect_governor_budget, 1, 1000);
+	effect_governor_restore =
+		CLAMP_INT(config.effect_governor_restore, 0, effect_governor_budget);
+	effect_governor_frames = CLAMP_INT(config.effect_governor_frames, 1, 10000);
+	config_auto_reload = CLAMP_INT(config.config_auto_reload, 0, 1);
+
+	snprintf(xkb_rules_rules, sizeof(xkb_rules_rules), "%s",
+			 config.xkb_rules_rules);
+	snprintf(xkb_rules_model, sizeof(xkb_rules_model), "%s",
+			 config.xkb_rules_model);
+	snprintf(xkb_rules_layout, sizeof(xkb_rules_layout), "%s",
+			 config.xkb_rules_layout);
+	snprintf(xkb_rules_variant, sizeof(xkb_rules_variant), "%s",
+			 config.xkb_rules_variant);
+	snprintf(xkb_rules_options, sizeof(xkb_rules_options), "%s",
+			 config.xkb_rules_options);
+	keymap_cache_update_rules(&xkb_rules);
+
+	for (int i = 0; i < config.env_count; i++)
+		setenv(config.env[i].name, config.env[i].value, 1);
 
 	// 复制颜色数组
 	memcpy(rootcolor, config.rootcolor, sizeof(rootcolor));
@@ -2313,145 +2514,168 @@ void override_config(void) {
 		   sizeof(animation_curve_close));
 }
 
-void set_value_default() {
+void set_value_default(Config *config) {
 	/* animaion */
-	config.animations = animations;					// 是否启用动画
-	config.layer_animations = layer_animations;		// 是否启用layer动画
-	config.animation_fade_in = animation_fade_in;	// Enable animation fade in
-	config.animation_fade_out = animation_fade_out; // Enable animation fade out
-	config.tag_animation_direction = tag_animation_direction; // 标签动画方向
-	config.zoom_initial_ratio = zoom_initial_ratio; // 动画起始窗口比例
-	config.zoom_end_ratio = zoom_end_ratio;			// 动画结束窗口比例
-	config.fadein_begin_opacity =
+	config->animations = animations;					// 是否启用动画
+	config->layer_animations = layer_animations;		// 是否启用layer动画
+	config->animation_fade_in = animation_fade_in;	// Enable animation fade in
+	config->animation_fade_out = animation_fade_out; // Enable animation fade out
+	config->tag_animation_direction = tag_animation_direction; // 标签动画方向
+	config->zoom_initial_ratio = zoom_initial_ratio; // 动画起始窗口比例
+	config->zoom_end_ratio = zoom_end_ratio;			// 动画结束窗口比例
+	config->fadein_begin_opacity =
 		fadein_begin_opacity; // Begin opac window ratio for animations
-	config.fadeout_begin_opacity = fadeout_begin_opacity;
-	config.animation_duration_move =
+	config->fadeout_begin_opacity = fadeout_begin_opacity;
+	config->animation_duration_move =
 		animation_duration_move; // Animation move speed
-	config.animation_duration_open =
+	config->animation_duration_open =
 		animation_duration_open; // Animation open speed
-	config.animation_duration_tag =
+	config->animation_duration_tag =
 		animation_duration_tag; // Animation tag speed
-	config.animation_duration_close =
+	config->animation_duration_close =
 		animation_duration_close; // Animation tag speed
 
 	/* appearance */
-	config.axis_bind_apply_timeout =
+	config->axis_bind_apply_timeout =
 		axis_bind_apply_timeout; // 滚轮绑定动作的触发的时间间隔
-	config.focus_on_activate =
+	config->title_update_interval = title_update_interval;
+	config->focus_on_activate =
 		focus_on_activate;					// 收到窗口激活请求是否自动跳转聚焦
-	config.new_is_master = new_is_master;	// 新窗口是否插在头部
-	config.default_mfact = default_mfact;	// master 窗口比例
-	config.default_smfact = default_smfact; // 第一个stack比例
-	config.default_nmaster = default_nmaster; // 默认master数量
-
-	config.numlockon = numlockon; // 是否打开右边小键盘
-
-	config.ov_tab_mode = ov_tab_mode;		// alt tab切换模式
-	config.hotarea_size = hotarea_size;		// 热区大小,10x10
-	config.enable_hotarea = enable_hotarea; // 是否启用鼠标热区
-	config.smartgaps =
+	config->new_is_master = new_is_master;	// 新窗口是否插在头部
+	config->default_mfact = default_mfact;	// master 窗口比例
+	config->default_smfact = default_smfact; // 第一个stack比例
+	config->default_nmaster = default_nmaster; // 默认master数量
+
+	config->numlockon = numlockon; // 是否打开右边小键盘
+
+	config->ov_tab_mode = ov_tab_mode;		// alt tab切换模式
+	config->ov_scale_buffers = ov_scale_buffers;
+	config->hotarea_size = hotarea_size;		// 热区大小,10x10
+	config->enable_hotarea = enable_hotarea; // 是否启用鼠标热区
+	config->smartgaps =
 		smartgaps; /* 1 means no outer gap when there is only one window */
-	config.sloppyfocus = sloppyfocus; /* focus follows mouse */
-	config.gappih = gappih;			  /* horiz inner gap between windows */
-	config.gappiv = gappiv;			  /* vert inner gap between windows */
-	config.gappoh =
+	config->sloppyfocus = sloppyfocus; /* focus follows mouse */
+	config->gappih = gappih;			  /* horiz inner gap between windows */
+	config->gappiv = gappiv;			  /* vert inner gap between windows */
+	config->gappoh =
 		gappoh; /* horiz outer gap between windows and screen edge */
-	config.gappov = gappov; /* vert outer gap between windows and screen edge */
-	config.scratchpad_width_ratio = scratchpad_width_ratio;
-	config.scratchpad_height_ratio = scratchpad_height_ratio;
+	config->gappov = gappov; /* vert outer gap between windows and screen edge */
+	config->scratchpad_width_ratio = scratchpad_width_ratio;
+	config->scratchpad_height_ratio = scratchpad_height_ratio;
 
-	config.scroller_structs = scroller_structs;
-	config.scroller_default_proportion = scroller_default_proportion;
-	config.scroller_default_proportion_single =
+	config->scroller_structs = scroller_structs;
+	config->scroller_default_proportion = scroller_default_proportion;
+	config->scroller_default_proportion_single =
 		scroller_default_proportion_single;
-	config.scroller_focus_center = scroller_focus_center;
-	config.scroller_prefer_center = scroller_prefer_center;
-	config.focus_cross_monitor = focus_cross_monitor;
-	config.focus_cross_tag = focus_cross_tag;
-	config.single_scratchpad = single_scratchpad;
-	config.xwayland_persistence = xwayland_persistence;
-	config.syncobj_enable = syncobj_enable;
-	config.no_border_when_single = no_border_when_single;
-	config.no_radius_when_single = no_radius_when_single;
-	config.snap_distance = snap_distance;
-	config.drag_tile_to_tile = drag_tile_to_tile;
-	config.enable_floating_snap = enable_floating_snap;
-	config.swipe_min_threshold = swipe_min_threshold;
-
-	config.inhibit_regardless_of_visibility =
+	config->scroller_focus_center = scroller_focus_center;
+	config->scroller_prefer_center = scroller_prefer_center;
+	config->focus_cross_monitor = focus_cross_monitor;
+	config->focus_cross_tag = focus_cross_tag;
+	config->single_scratchpad = single_scratchpad;
+	config->xwayland_persistence = xwayland_persistence;
+	config->xwayland_lazy = xwayland_lazy;
+	config->xwayland_prewarm_delay = xwayland_prewarm_delay;
+	config->syncobj_enable = syncobj_enable;
+	config->allow_tearing = allow_tearing;
+	config->hidden_frame_rate = hidden_frame_rate;
+	config->asleep_frame_rate = asleep_frame_rate;
+	config->no_border_when_single = no_border_when_single;
+	config->no_radius_when_single = no_radius_when_single;
+	config->snap_distance = snap_distance;
+	config->drag_tile_to_tile = drag_tile_to_tile;
+	config->enable_floating_snap = enable_floating_snap;
+	config->swipe_min_threshold = swipe_min_threshold;
+
+	config->inhibit_regardless_of_visibility =
 		inhibit_regardless_of_visibility; /* 1 means idle inhibitors will
 									  disable idle tracking even if it's surface
 									  isn't visible
 									*/
 
-	config.borderpx = borderpx;
-	config.overviewgappi = overviewgappi; /* overview时 窗口与边缘 缝隙大小 */
-	config.overviewgappo = overviewgappo; /* overview时 窗口与窗口 缝隙大小 */
-	config.cursor_hide_timeout = cursor_hide_timeout;
+	config->borderpx = borderpx;
+	config->overviewgappi = overviewgappi; /* overview时 窗口与边缘 缝隙大小 */
+	config->overviewgappo = overviewgappo; /* overview时 窗口与窗口 缝隙大小 */
+	config->cursor_hide_timeout = cursor_hide_timeout;
 
-	config.warpcursor = warpcursor; /* Warp cursor to focused client */
+	config->warpcursor = warpcursor; /* Warp cursor to focused client */
 
-	config.repeat_rate = repeat_rate;
-	config.repeat_delay = repeat_delay;
+	config->repeat_rate = repeat_rate;
+	config->repeat_delay = repeat_delay;
 
 	/* Trackpad */
-	config.disable_trackpad = disable_trackpad;
-	config.tap_to_click = tap_to_click;
-	config.tap_and_drag = tap_and_drag;
-	config.drag_lock = drag_lock;
-	config.mouse_natural_scrolling = mouse_natural_scrolling;
-	config.cursor_size = cursor_size;
-	config.trackpad_natural_scrolling = trackpad_natural_scrolling;
-	config.disable_while_typing = disable_while_typing;
-	config.left_handed = left_handed;
-	config.middle_button_emulation = middle_button_emulation;
-	config.accel_profile = accel_profile;
-	config.accel_speed = accel_speed;
-	config.scroll_method = scroll_method;
-	config.scroll_button = scroll_button;
-	config.click_method = click_method;
-	config.send_events_mode = send_events_mode;
-	config.button_map = button_map;
-
-	config.blur = blur;
-	config.blur_layer = blur_layer;
-	config.blur_optimized = blur_optimized;
-	config.border_radius = border_radius;
-	config.blur_params.num_passes = blur_params_num_passes;
-	config.blur_params.radius = blur_params_radius;
-	config.blur_params.noise = blur_params_noise;
-	config.blur_params.brightness = blur_params_brightness;
-	config.blur_params.contrast = blur_params_contrast;
-	config.blur_params.saturation = blur_params_saturation;
-	config.shadows = shadows;
-	config.shadow_only_floating = shadow_only_floating;
-	config.layer_shadows = layer_shadows;
-	config.shadows_size = shadows_size;
-	config.shadows_blur = shadows_blur;
-	config.shadows_position_x = shadows_position_x;
-	config.shadows_position_y = shadows_position_y;
-	config.focused_opacity = focused_opacity;
-	config.unfocused_opacity = unfocused_opacity;
-	memcpy(config.shadowscolor, shadowscolor, sizeof(shadowscolor));
-
-	memcpy(config.animation_curve_move, animation_curve_move,
+	config->disable_trackpad = disable_trackpad;
+	config->tap_to_click = tap_to_click;
+	config->tap_and_drag = tap_and_drag;
+	config->drag_lock = drag_lock;
+	config->mouse_natural_scrolling = mouse_natural_scrolling;
+	config->cursor_size = cursor_size;
+	config->trackpad_natural_scrolling = trackpad_natural_scrolling;
+	config->disable_while_typing = disable_while_typing;
+	config->left_handed = left_handed;
+	config->middle_button_emulation = middle_button_emulation;
+	config->accel_profile = accel_profile;
+	config->accel_speed = accel_speed;
+	config->scroll_method = scroll_method;
+	config->scroll_button = scroll_button;
+	config->click_method = click_method;
+	config->send_events_mode = send_events_mode;
+	config->button_map = button_map;
+
+	config->blur = blur;
+	config->blur_layer = blur_layer;
+	config->blur_optimized = blur_optimized;
+	config->border_radius = border_radius;
+	config->blur_params.num_passes = blur_params_num_passes;
+	config->blur_params.radius = blur_params_radius;
+	config->blur_params.noise = blur_params_noise;
+	config->blur_params.brightness = blur_params_brightness;
+	config->blur_params.contrast = blur_params_contrast;
+	config->blur_params.saturation = blur_params_saturation;
+	config->shadows = shadows;
+	config->shadow_only_floating = shadow_only_floating;
+	config->layer_shadows = layer_shadows;
+	config->shadows_size = shadows_size;
+	config->shadows_blur = shadows_blur;
+	config->shadows_position_x = shadows_position_x;
+	config->shadows_position_y = shadows_position_y;
+	config->focused_opacity = focused_opacity;
+	config->unfocused_opacity = unfocused_opacity;
+	memcpy(config->shadowscolor, shadowscolor, sizeof(shadowscolor));
+	config->effect_governor = effect_governor;
+	config->effect_governor_budget = effect_governor_budget;
+	config->effect_governor_restore = effect_governor_restore;
+	config->effect_governor_frames = effect_governor_frames;
+	config->config_auto_reload = config_auto_reload;
+
+	memcpy(config->animation_curve_move, animation_curve_move,
 		   sizeof(animation_curve_move));
-	memcpy(config.animation_curve_open, animation_curve_open,
+	memcpy(config->animation_curve_open, animation_curve_open,
 		   sizeof(animation_curve_open));
-	memcpy(config.animation_curve_tag, animation_curve_tag,
+	memcpy(config->animation_curve_tag, animation_curve_tag,
 		   sizeof(animation_curve_tag));
-	memcpy(config.animation_curve_close, animation_curve_close,
+	memcpy(config->animation_curve_close, animation_curve_close,
 		   sizeof(animation_curve_close));
 
-	memcpy(config.rootcolor, rootcolor, sizeof(rootcolor));
-	memcpy(config.bordercolor, bordercolor, sizeof(bordercolor));
-	memcpy(config.focuscolor, focuscolor, sizeof(focuscolor));
-	memcpy(config.maxmizescreencolor, maxmizescreencolor,
+	memcpy(config->rootcolor, rootcolor, sizeof(rootcolor));
+	memcpy(config->bordercolor, bordercolor, sizeof(bordercolor));
+	memcpy(config->focuscolor, focuscolor, sizeof(focuscolor));
+	memcpy(config->maxmizescreencolor, maxmizescreencolor,
 		   sizeof(maxmizescreencolor));
-	memcpy(config.urgentcolor, urgentcolor, sizeof(urgentcolor));
-	memcpy(config.scratchpadcolor, scratchpadcolor, sizeof(scratchpadcolor));
-	memcpy(config.globalcolor, globalcolor, sizeof(globalcolor));
-	memcpy(config.overlaycolor, overlaycolor, sizeof(overlaycolor));
+	memcpy(config->urgentcolor, urgentcolor, sizeof(urgentcolor));
+	memcpy(config->scratchpadcolor, scratchpadcolor, sizeof(scratchpadcolor));
+	memcpy(config->globalcolor, globalcolor, sizeof(globalcolor));
+	memcpy(config->overlaycolor, overlaycolor, sizeof(overlaycolor));
+	// 键盘布局字符串在主线程发布时再写回全局变量
+	snprintf(config->xkb_rules_rules, sizeof(config->xkb_rules_rules), "%s",
+			 xkb_rules_rules);
+	snprintf(config->xkb_rules_model, sizeof(config->xkb_rules_model), "%s",
+			 xkb_rules_model);
+	snprintf(config->xkb_rules_layout, sizeof(config->xkb_rules_layout), "%s",
+			 xkb_rules_layout);
+	snprintf(config->xkb_rules_variant, sizeof(config->xkb_rules_variant),
+			 "%s", xkb_rules_variant);
+	snprintf(config->xkb_rules_options, sizeof(config->xkb_rules_options),
+			 "%s", xkb_rules_options);
 }
 
 void set_default_key_bindings(Config *config) {
@@ -2459,59 +2683,16 @@ void set_default_key_bindings(Config *config) {
 	size_t default_key_bindings_count =
 		sizeof(default_key_bindings) / sizeof(KeyBinding);
 
-	// 重新分配内存以容纳新的默认按键绑定
-	config->key_bindings =
-		realloc(config->key_bindings,
-				(config->key_bindings_count + default_key_bindings_count) *
-					sizeof(KeyBinding));
-	if (!config->key_bindings) {
-		return;
-	}
-
-	// 将默认按键绑定复制到配置的按键绑定数组中
+	// 将默认按键绑定追加到配置的按键绑定数组中
 	for (size_t i = 0; i < default_key_bindings_count; i++) {
-		config->key_bindings[config->key_bindings_count + i] =
+		if (!CONFIG_ARRAY_RESERVE(config, key_bindings))
+			return;
+		config->key_bindings[config->key_bindings_count++] =
 			default_key_bindings[i];
 	}
-
-	// 更新按键绑定的总数
-	config->key_bindings_count += default_key_bindings_count;
 }
 
-void parse_config(void) {
-
-	char filename[1024];
-
-	free_config();
-
-	// 重置config结构体，确保所有指针初始化为NULL
-	memset(&config, 0, sizeof(config));
-
-	// 初始化动态数组的指针为NULL，避免野指针
-	config.window_rules = NULL;
-	config.window_rules_count = 0;
-	config.monitor_rules = NULL;
-	config.monitor_rules_count = 0;
-	config.key_bindings = NULL;
-	config.key_bindings_count = 0;
-	config.mouse_bindings = NULL;
-	config.mouse_bindings_count = 0;
-	config.axis_bindings = NULL;
-	config.axis_bindings_count = 0;
-	config.gesture_bindings = NULL;
-	config.gesture_bindings_count = 0;
-	config.exec = NULL;
-	config.exec_count = 0;
-	config.exec_once = NULL;
-	config.exec_once_count = 0;
-	config.scroller_proportion_preset = NULL;
-	config.scroller_proportion_preset_count = 0;
-	config.circle_layout = NULL;
-	config.circle_layout_count = 0;
-	config.tag_rules = NULL;
-	config.tag_rules_count = 0;
-	config.cursor_theme = NULL;
-
+bool get_config_path(char *filename, size_t size) {
 	// 获取 MANGOCONFIG 环境变量
 	const char *mangoconfig = getenv("MANGOCONFIG");
 
@@ -2521,33 +2702,77 @@ void parse_config(void) {
 		const char *homedir = getenv("HOME");
 		if (!homedir) {
 			// 如果获取失败，则无法继续
-			return;
+			return false;
 		}
 		// 构建日志文件路径
-		snprintf(filename, sizeof(filename), "%s/.config/mango/config.conf",
-				 homedir);
+		snprintf(filename, size, "%s/.config/mango/config.conf", homedir);
 
 		// 检查文件是否存在
 		if (access(filename, F_OK) != 0) {
 			// 如果文件不存在，则使用 /etc/mango/config.conf
-			snprintf(filename, sizeof(filename), "%s/mango/config.conf",
-					 SYSCONFDIR);
+			snprintf(filename, size, "%s/mango/config.conf", SYSCONFDIR);
 		}
 	} else {
 		// 使用 MANGOCONFIG 环境变量作为配置文件夹路径
-		snprintf(filename, sizeof(filename), "%s/config.conf", mangoconfig);
+		snprintf(filename, size, "%s/config.conf", mangoconfig);
 	}
+	return true;
+}
+
+// 新配置从当前全局值开始,只能在主线程调用
+void prepare_config(Config *next) {
+	memset(next, 0, sizeof(*next));
+	set_value_default(next);
+}
 
-	set_value_default();
-	parse_config_file(&config, filename);
-	set_default_key_bindings(&config);
+// 用新配置替换当前配置,旧配置的arena整块释放
+void publish_config(Config *next) {
+	ConfigArena old_arena = config.arena;
+
+	free_baked_points();
+	config = *next;
 	override_config();
+	config_arena_release(&old_arena);
+	config_generation++;
+}
+
+void parse_config(void) {
+	char filename[1024];
+	bool has_path = get_config_path(filename, sizeof(filename));
+	// 缓存只对应从预设值开始的解析,重载时的起始值是上一份配置
+	bool use_cache = has_path && config_generation == 0;
+	Config next;
+
+	prepare_config(&next);
+	if (use_cache && config_cache_load(&next, filename)) {
+		publish_config(&next);
+		return;
+	}
+	if (has_path) {
+		config_units_begin();
+		parse_config_file(&next, filename);
+		config_units_end();
+	}
+	set_default_key_bindings(&next);
+	if (use_cache)
+		config_cache_save(&next, filename);
+	publish_config(&next);
 }
 
 void reset_blur_params(void) {
+	LayerSurface *l;
+	int i;
+
 	if (blur) {
 		Monitor *m;
 		wl_list_for_each(m, &mons, link) {
+			// 下次提交时重新设置layer的模糊
+			for (i = 0; i < LENGTH(m->layers); i++) {
+				wl_list_for_each(l, &m->layers[i], link) {
+					l->blur_dirty = true;
+				}
+			}
+
 			if (m->blur != NULL) {
 				wlr_scene_node_destroy(&m->blur->node);
 			}
@@ -2631,6 +2856,9 @@ void reapply_border(void) {
 			if (c->bw && !c->isnoborder) {
 				c->bw = borderpx;
 			}
+			// 圆角和阴影参数可能变化,强制重新设置装饰
+			c->border_state.valid = false;
+			c->shadow_state.valid = false;
 		}
 	}
 }
@@ -2691,12 +2919,12 @@ void reapply_tagrule(void) {
 	}
 }
 
-void reload_config(const Arg *arg) {
-	parse_config();
+void apply_reloaded_config(void) {
 	init_baked_points();
 	handlecursoractivity();
 	reset_keyboard_layout();
 	reset_blur_params();
+	reset_effect_governor();
 	run_exec();
 
 	reapply_border();
@@ -2706,5 +2934,207 @@ void reload_config(const Arg *arg) {
 	reapply_tagrule();
 	reapply_monitor_rules();
 
+	update_config_watch();
+
 	arrange(selmon, false);
 }
+
+static void *config_parse_thread(void *data) {
+	ConfigJob *job = data;
+	uint64_t one = 1;
+
+	config_units_begin();
+	parse_config_file(&job->config, job->path);
+	config_units_end();
+	set_default_key_bindings(&job->config);
+
+	atomic_store_explicit(&config_job_done, job, memory_order_release);
+	if (write(config_event_fd, &one, sizeof(one)) < 0)
+		fprintf(stderr, "Error: Failed to signal config reload\n");
+	return NULL;
+}
+
+// 在后台线程解析配置,失败时返回false由调用者同步解析
+bool start_config_parse(void) {
+	ConfigJob *job;
+	sigset_t all, old;
+	int ret;
+
+	if (config_event_fd < 0)
+		return false;
+
+	if (config_thread_running) {
+		config_reload_queued = true;
+		return true;
+	}
+
+	job = ecalloc(1, sizeof(*job));
+	if (!get_config_path(job->path, sizeof(job->path))) {
+		free(job);
+		return false;
+	}
+	prepare_config(&job->config);
+	init_dispatcher_table();
+
+	// 信号只由主线程处理
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	ret = pthread_create(&config_thread, NULL, config_parse_thread, job);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (ret != 0) {
+		config_arena_release(&job->config.arena);
+		free(job);
+		return false;
+	}
+	config_thread_running = true;
+	return true;
+}
+
+static int config_parse_done(int fd, uint32_t mask, void *data) {
+	ConfigJob *job;
+	uint64_t count;
+
+	if (read(fd, &count, sizeof(count)) < 0)
+		return 0;
+
+	job = atomic_exchange_explicit(&config_job_done, NULL,
+								   memory_order_acquire);
+	if (!job)
+		return 0;
+
+	pthread_join(config_thread, NULL);
+	config_thread_running = false;
+
+	publish_config(&job->config);
+	free(job);
+	wlr_log(WLR_DEBUG, "config generation %u published", config_generation);
+	apply_reloaded_config();
+
+	if (config_reload_queued) {
+		config_reload_queued = false;
+		reload_config(NULL);
+	}
+	return 0;
+}
+
+static int config_watch_timeout(void *data) {
+	reload_config(NULL);
+	return 0;
+}
+
+static int config_watch_event(int fd, uint32_t mask, void *data) {
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	bool changed = false;
+	ssize_t len;
+	size_t name_len;
+
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		for (char *ptr = buf; ptr < buf + len;
+			 ptr += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *)ptr;
+			if (!event->len)
+				continue;
+			name_len = strlen(event->name);
+			if (name_len > 5 &&
+				strcmp(event->name + name_len - 5, ".conf") == 0)
+				changed = true;
+		}
+	}
+
+	// 编辑器保存时会产生多个事件,合并后再重载
+	if (changed)
+		wl_event_source_timer_update(config_watch_timer, 200);
+	return 0;
+}
+
+void update_config_watch(void) {
+	char path[1024];
+	char *slash;
+
+	if (!config_auto_reload) {
+		if (config_watch_source) {
+			wl_event_source_remove(config_watch_source);
+			wl_event_source_remove(config_watch_timer);
+			close(config_watch_fd);
+			config_watch_source = NULL;
+			config_watch_timer = NULL;
+			config_watch_fd = -1;
+		}
+		return;
+	}
+
+	if (config_watch_source || !get_config_path(path, sizeof(path)))
+		return;
+
+	if ((slash = strrchr(path, '/')))
+		*slash = '\0';
+
+	config_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (config_watch_fd < 0)
+		return;
+
+	if (inotify_add_watch(config_watch_fd, path,
+						  IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE |
+							  IN_DELETE) < 0) {
+		wlr_log(WLR_ERROR, "failed to watch config directory %s", path);
+		close(config_watch_fd);
+		config_watch_fd = -1;
+		return;
+	}
+
+	config_watch_source =
+		wl_event_loop_add_fd(event_loop, config_watch_fd, WL_EVENT_READABLE,
+							 config_watch_event, NULL);
+	config_watch_timer =
+		wl_event_loop_add_timer(event_loop, config_watch_timeout, NULL);
+}
+
+void init_config_reload(void) {
+	config_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (config_event_fd < 0) {
+		wlr_log(WLR_ERROR, "failed to create config eventfd, reload will "
+						   "parse synchronously");
+		return;
+	}
+	config_event_source =
+		wl_event_loop_add_fd(event_loop, config_event_fd, WL_EVENT_READABLE,
+							 config_parse_done, NULL);
+	update_config_watch();
+}
+
+void finish_config_reload(void) {
+	ConfigJob *job;
+
+	if (config_thread_running) {
+		pthread_join(config_thread, NULL);
+		config_thread_running = false;
+		job = atomic_exchange(&config_job_done, NULL);
+		if (job) {
+			config_arena_release(&job->config.arena);
+			free(job);
+		}
+	}
+
+	config_auto_reload = 0;
+	update_config_watch();
+
+	if (config_event_source) {
+		wl_event_source_remove(config_event_source);
+		config_event_source = NULL;
+	}
+	if (config_event_fd >= 0) {
+		close(config_event_fd);
+		config_event_fd = -1;
+	}
+}
+
+void reload_config(const Arg *arg) {
+	if (start_config_parse())
+		return;
+
+	parse_config();
+	apply_reloaded_config();
+}
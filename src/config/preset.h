@@ -32,6 +32,7 @@ double animation_curve_close[4] = {0.46, 1.0, 0.29, 0.99}; // 动画曲线
 
 /* appearance */
 unsigned int axis_bind_apply_timeout = 100; // 滚轮绑定动作的触发的时间间隔
+unsigned int title_update_interval = 100; // 标题/appid变化的最小发布间隔(ms)
 unsigned int focus_on_activate = 1;			// 收到窗口激活请求是否自动跳转聚焦
 unsigned int new_is_master = 1;				// 新窗口是否插在头部
 double default_mfact = 0.55f;				// master 窗口比例
@@ -43,6 +44,7 @@ unsigned int numlockon = 1; // 是否打开右边小键盘
 unsigned int capslock = 0;	// 是否启用快捷键
 
 unsigned int ov_tab_mode = 0;	 // alt tab切换模式
+unsigned int ov_scale_buffers = 1; // overview缩放窗口画面而不是改变窗口大小
 unsigned int hotarea_size = 10;	 // 热区大小,10x10
 unsigned int enable_hotarea = 1; // 是否启用鼠标热区
 int smartgaps = 0;	 /* 1 means no outer gap when there is only one window */
@@ -94,7 +96,12 @@ float fullscreen_bg[] = {0.1, 0.1, 0.1, 1.0};
 
 int warpcursor = 1;			  /* Warp cursor to focused client */
 int xwayland_persistence = 1; /* xwayland persistence */
+int xwayland_lazy = 0; /* 第一个X11客户端连接时才启动xwayland */
+int xwayland_prewarm_delay = 0; /* lazy且persistence时无输入多少秒后预先启动,0为不预热 */
 int syncobj_enable = 0;
+int allow_tearing = 0; /* 0:禁止 1:跟随客户端提示 2:全屏时强制撕裂 */
+int hidden_frame_rate = 1; /* 隐藏窗口每秒合成的frame done次数,0为不发送 */
+int asleep_frame_rate = 0; /* 关闭(dpms)的输出上的窗口 */
 
 /* keyboard */
 
@@ -203,4 +210,14 @@ double shadows_blur = 15;
 int shadows_position_x = 0;
 int shadows_position_y = 0;
 float shadowscolor[] = COLOR(0x000000ff);
+
+/* 根据每个显示器从提交到显示的延迟自动降低特效质量,
+ * GPU跟不上时翻页会错过vblank,延迟超过一个刷新间隔 */
+int effect_governor = 0;
+int effect_governor_budget = 150;  /* 延迟超过刷新间隔的百分比时降级 */
+int effect_governor_restore = 110; /* 延迟低于刷新间隔的百分比时恢复 */
+int effect_governor_frames = 30;   /* 连续多少帧满足条件才切换等级 */
+
+/* 配置文件所在目录有改动时自动重载 */
+int config_auto_reload = 0;
 ;
@@ -0,0 +1,503 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* 启动时解析好的配置序列化到 $XDG_CACHE_HOME/mango,
+ * 下次启动时所有配置文件和mango本身都没变就直接加载,跳过文本解析 */
+
+#define CONFIG_CACHE_MAGIC 0x4643474du /* "MGCF" */
+#define CONFIG_CACHE_VERSION 1
+#define CONFIG_CACHE_NULL UINT32_MAX
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t config_size; // sizeof(Config),结构体变化后缓存失效
+	uint32_t dispatcher_count;
+	FileStamp exe; // mango可执行文件,预设值和函数表都跟着它变
+	uint64_t payload_size;
+	uint32_t checksum;
+} ConfigCacheHeader;
+
+typedef struct {
+	char *data;
+	size_t len;
+	size_t cap;
+	bool failed;
+} ConfigCacheWriter;
+
+typedef struct {
+	const char *data;
+	size_t len;
+	size_t pos;
+	ConfigArena *arena;
+	bool failed;
+} ConfigCacheReader;
+
+static uint32_t config_cache_checksum(const char *data, size_t len) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool config_cache_path(const char *config_path, char *path,
+							  size_t size, bool create_dir) {
+	const char *cache_home = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	char dir[1024];
+
+	if (cache_home && cache_home[0] != '\0')
+		snprintf(dir, sizeof(dir), "%s", cache_home);
+	else if (home)
+		snprintf(dir, sizeof(dir), "%s/.cache", home);
+	else
+		return false;
+
+	if (create_dir)
+		mkdir(dir, 0700);
+	strncat(dir, "/mango", sizeof(dir) - strlen(dir) - 1);
+	if (create_dir && mkdir(dir, 0700) < 0 && errno != EEXIST)
+		return false;
+
+	// 不同的MANGOCONFIG使用不同的缓存文件
+	snprintf(path, size, "%s/config-%08x.cache", dir,
+			 config_cache_checksum(config_path, strlen(config_path)));
+	return true;
+}
+
+static bool config_cache_exe_stamp(FileStamp *stamp) {
+	return file_stamp_get("/proc/self/exe", stamp);
+}
+
+static void cache_put(ConfigCacheWriter *w, const void *data, size_t len) {
+	if (w->failed || !len)
+		return;
+	if (w->len + len > w->cap) {
+		size_t cap = w->cap ? w->cap : 16384;
+		char *new_data;
+		while (cap < w->len + len)
+			cap *= 2;
+		if (!(new_data = realloc(w->data, cap))) {
+			w->failed = true;
+			return;
+		}
+		w->data = new_data;
+		w->cap = cap;
+	}
+	memcpy(w->data + w->len, data, len);
+	w->len += len;
+}
+
+static void cache_put_u32(ConfigCacheWriter *w, uint32_t value) {
+	cache_put(w, &value, sizeof(value));
+}
+
+static void cache_put_str(ConfigCacheWriter *w, const char *str) {
+	uint32_t len = str ? strlen(str) : CONFIG_CACHE_NULL;
+
+	cache_put_u32(w, len);
+	if (str)
+		cache_put(w, str, len);
+}
+
+// 函数指针按dispatchers中的下标保存
+static void cache_put_func(ConfigCacheWriter *w, FuncType func) {
+	uint32_t index = CONFIG_CACHE_NULL;
+
+	if (func) {
+		for (index = 0; index < LENGTH(dispatchers); index++) {
+			if (dispatchers[index].func == func)
+				break;
+		}
+		if (index == LENGTH(dispatchers))
+			w->failed = true;
+	}
+	cache_put_u32(w, index);
+}
+
+static void cache_put_arg(ConfigCacheWriter *w, const Arg *arg) {
+	cache_put_str(w, arg->v);
+	cache_put_str(w, arg->v2);
+	cache_put_str(w, arg->v3);
+}
+
+static bool cache_get(ConfigCacheReader *r, void *data, size_t len) {
+	if (r->failed || len > r->len - r->pos) {
+		r->failed = true;
+		return false;
+	}
+	memcpy(data, r->data + r->pos, len);
+	r->pos += len;
+	return true;
+}
+
+static uint32_t cache_get_u32(ConfigCacheReader *r) {
+	uint32_t value = 0;
+
+	cache_get(r, &value, sizeof(value));
+	return value;
+}
+
+static char *cache_get_str(ConfigCacheReader *r) {
+	uint32_t len = cache_get_u32(r);
+	char *str;
+
+	if (r->failed || len == CONFIG_CACHE_NULL)
+		return NULL;
+	if (len > r->len - r->pos ||
+		!(str = config_arena_alloc(r->arena, (size_t)len + 1))) {
+		r->failed = true;
+		return NULL;
+	}
+	cache_get(r, str, len);
+	return str;
+}
+
+static FuncType cache_get_func(ConfigCacheReader *r) {
+	uint32_t index = cache_get_u32(r);
+
+	if (index == CONFIG_CACHE_NULL)
+		return NULL;
+	if (index >= LENGTH(dispatchers)) {
+		r->failed = true;
+		return NULL;
+	}
+	return dispatchers[index].func;
+}
+
+static void cache_get_arg(ConfigCacheReader *r, Arg *arg) {
+	arg->v = cache_get_str(r);
+	arg->v2 = cache_get_str(r);
+	arg->v3 = cache_get_str(r);
+}
+
+// 数组元素原样保存,里面的指针之后单独写入
+static void *cache_get_array(ConfigCacheReader *r, int count,
+							 size_t elem_size) {
+	size_t len;
+	void *array;
+
+	if (count <= 0 || r->failed)
+		return NULL;
+	len = (size_t)count * elem_size;
+	if (len / elem_size != (size_t)count || len > r->len - r->pos ||
+		!(array = config_arena_alloc(r->arena, len))) {
+		r->failed = true;
+		return NULL;
+	}
+	cache_get(r, array, len);
+	return array;
+}
+
+#define CACHE_PUT_ARRAY(w, cfg, name)                                          \
+	cache_put(w, (cfg)->name,                                                  \
+			  (cfg)->name##_count > 0                                          \
+				  ? (size_t)(cfg)->name##_count * sizeof(*(cfg)->name)         \
+				  : 0)
+
+#define CACHE_GET_ARRAY(r, cfg, name)                                          \
+	((cfg)->name =                                                             \
+		 cache_get_array(r, (cfg)->name##_count, sizeof(*(cfg)->name)))
+
+static void config_cache_write_payload(ConfigCacheWriter *w,
+									   const Config *config) {
+	int i;
+
+	cache_put(w, config, sizeof(*config));
+
+	if (config->scroller_proportion_preset)
+		CACHE_PUT_ARRAY(w, config, scroller_proportion_preset);
+	CACHE_PUT_ARRAY(w, config, circle_layout);
+	for (i = 0; i < config->circle_layout_count; i++)
+		cache_put_str(w, config->circle_layout[i]);
+
+	CACHE_PUT_ARRAY(w, config, tag_rules);
+	for (i = 0; i < config->tag_rules_count; i++) {
+		cache_put_str(w, config->tag_rules[i].layout_name);
+		cache_put_str(w, config->tag_rules[i].monitor_name);
+	}
+
+	CACHE_PUT_ARRAY(w, config, layer_rules);
+	for (i = 0; i < config->layer_rules_count; i++) {
+		cache_put_str(w, config->layer_rules[i].layer_name);
+		cache_put_str(w, config->layer_rules[i].animation_type_open);
+		cache_put_str(w, config->layer_rules[i].animation_type_close);
+	}
+
+	CACHE_PUT_ARRAY(w, config, window_rules);
+	for (i = 0; i < config->window_rules_count; i++) {
+		const ConfigWinRule *rule = &config->window_rules[i];
+		cache_put_str(w, rule->id);
+		cache_put_str(w, rule->title);
+		cache_put_str(w, rule->animation_type_open);
+		cache_put_str(w, rule->animation_type_close);
+		cache_put_str(w, rule->layer_animation_type_open);
+		cache_put_str(w, rule->layer_animation_type_close);
+		cache_put_str(w, rule->monitor);
+		cache_put_func(w, rule->globalkeybinding.func);
+		cache_put_arg(w, &rule->globalkeybinding.arg);
+	}
+
+	CACHE_PUT_ARRAY(w, config, monitor_rules);
+	for (i = 0; i < config->monitor_rules_count; i++) {
+		cache_put_str(w, config->monitor_rules[i].name);
+		cache_put_str(w, config->monitor_rules[i].layout);
+	}
+
+	CACHE_PUT_ARRAY(w, config, key_bindings);
+	for (i = 0; i < config->key_bindings_count; i++) {
+		cache_put_func(w, config->key_bindings[i].func);
+		cache_put_arg(w, &config->key_bindings[i].arg);
+	}
+	CACHE_PUT_ARRAY(w, config, mouse_bindings);
+	for (i = 0; i < config->mouse_bindings_count; i++) {
+		cache_put_func(w, config->mouse_bindings[i].func);
+		cache_put_arg(w, &config->mouse_bindings[i].arg);
+	}
+	CACHE_PUT_ARRAY(w, config, axis_bindings);
+	for (i = 0; i < config->axis_bindings_count; i++) {
+		cache_put_func(w, config->axis_bindings[i].func);
+		cache_put_arg(w, &config->axis_bindings[i].arg);
+	}
+	CACHE_PUT_ARRAY(w, config, gesture_bindings);
+	for (i = 0; i < config->gesture_bindings_count; i++) {
+		cache_put_func(w, config->gesture_bindings[i].func);
+		cache_put_arg(w, &config->gesture_bindings[i].arg);
+	}
+
+	CACHE_PUT_ARRAY(w, config, exec);
+	for (i = 0; i < config->exec_count; i++)
+		cache_put_str(w, config->exec[i]);
+	CACHE_PUT_ARRAY(w, config, exec_once);
+	for (i = 0; i < config->exec_once_count; i++)
+		cache_put_str(w, config->exec_once[i]);
+
+	cache_put_str(w, config->cursor_theme);
+
+	CACHE_PUT_ARRAY(w, config, env);
+	for (i = 0; i < config->env_count; i++) {
+		cache_put_str(w, config->env[i].name);
+		cache_put_str(w, config->env[i].value);
+	}
+
+	CACHE_PUT_ARRAY(w, config, files);
+	for (i = 0; i < config->files_count; i++)
+		cache_put_str(w, config->files[i].path);
+}
+
+// 和config_cache_write_payload的顺序一一对应
+static bool config_cache_read_payload(ConfigCacheReader *r, Config *config) {
+	int i;
+
+	if (!cache_get(r, config, sizeof(*config)))
+		return false;
+	// 原始结构体里的指针都是上次运行的地址,下面逐个替换
+	config->arena = (ConfigArena){0};
+	config->xkb_rules = (struct xkb_rule_names){0};
+	r->arena = &config->arena;
+
+	if (config->scroller_proportion_preset)
+		CACHE_GET_ARRAY(r, config, scroller_proportion_preset);
+	CACHE_GET_ARRAY(r, config, circle_layout);
+	for (i = 0; i < config->circle_layout_count && !r->failed; i++)
+		config->circle_layout[i] = cache_get_str(r);
+
+	CACHE_GET_ARRAY(r, config, tag_rules);
+	for (i = 0; i < config->tag_rules_count && !r->failed; i++) {
+		config->tag_rules[i].layout_name = cache_get_str(r);
+		config->tag_rules[i].monitor_name = cache_get_str(r);
+	}
+
+	CACHE_GET_ARRAY(r, config, layer_rules);
+	for (i = 0; i < config->layer_rules_count && !r->failed; i++) {
+		config->layer_rules[i].layer_name = cache_get_str(r);
+		config->layer_rules[i].animation_type_open = cache_get_str(r);
+		config->layer_rules[i].animation_type_close = cache_get_str(r);
+	}
+
+	CACHE_GET_ARRAY(r, config, window_rules);
+	for (i = 0; i < config->window_rules_count && !r->failed; i++) {
+		ConfigWinRule *rule = &config->window_rules[i];
+		rule->id = cache_get_str(r);
+		rule->title = cache_get_str(r);
+		rule->animation_type_open = cache_get_str(r);
+		rule->animation_type_close = cache_get_str(r);
+		rule->layer_animation_type_open = cache_get_str(r);
+		rule->layer_animation_type_close = cache_get_str(r);
+		rule->monitor = cache_get_str(r);
+		rule->globalkeybinding.func = cache_get_func(r);
+		cache_get_arg(r, &rule->globalkeybinding.arg);
+	}
+
+	CACHE_GET_ARRAY(r, config, monitor_rules);
+	for (i = 0; i < config->monitor_rules_count && !r->failed; i++) {
+		config->monitor_rules[i].name = cache_get_str(r);
+		config->monitor_rules[i].layout = cache_get_str(r);
+	}
+
+	CACHE_GET_ARRAY(r, config, key_bindings);
+	for (i = 0; i < config->key_bindings_count && !r->failed; i++) {
+		config->key_bindings[i].func = cache_get_func(r);
+		cache_get_arg(r, &config->key_bindings[i].arg);
+	}
+	CACHE_GET_ARRAY(r, config, mouse_bindings);
+	for (i = 0; i < config->mouse_bindings_count && !r->failed; i++) {
+		config->mouse_bindings[i].func = cache_get_func(r);
+		cache_get_arg(r, &config->mouse_bindings[i].arg);
+	}
+	CACHE_GET_ARRAY(r, config, axis_bindings);
+	for (i = 0; i < config->axis_bindings_count && !r->failed; i++) {
+		config->axis_bindings[i].func = cache_get_func(r);
+		cache_get_arg(r, &config->axis_bindings[i].arg);
+	}
+	CACHE_GET_ARRAY(r, config, gesture_bindings);
+	for (i = 0; i < config->gesture_bindings_count && !r->failed; i++) {
+		config->gesture_bindings[i].func = cache_get_func(r);
+		cache_get_arg(r, &config->gesture_bindings[i].arg);
+	}
+
+	CACHE_GET_ARRAY(r, config, exec);
+	for (i = 0; i < config->exec_count && !r->failed; i++)
+		config->exec[i] = cache_get_str(r);
+	CACHE_GET_ARRAY(r, config, exec_once);
+	for (i = 0; i < config->exec_once_count && !r->failed; i++)
+		config->exec_once[i] = cache_get_str(r);
+
+	config->cursor_theme = cache_get_str(r);
+
+	CACHE_GET_ARRAY(r, config, env);
+	for (i = 0; i < config->env_count && !r->failed; i++) {
+		config->env[i].name = cache_get_str(r);
+		config->env[i].value = cache_get_str(r);
+	}
+
+	CACHE_GET_ARRAY(r, config, files);
+	for (i = 0; i < config->files_count && !r->failed; i++)
+		config->files[i].path = cache_get_str(r);
+
+	// 数组按实际数量分配,之后追加时会重新扩容
+	config->tag_rules_cap = config->tag_rules_count;
+	config->layer_rules_cap = config->layer_rules_count;
+	config->window_rules_cap = config->window_rules_count;
+	config->monitor_rules_cap = config->monitor_rules_count;
+	config->key_bindings_cap = config->key_bindings_count;
+	config->mouse_bindings_cap = config->mouse_bindings_count;
+	config->axis_bindings_cap = config->axis_bindings_count;
+	config->gesture_bindings_cap = config->gesture_bindings_count;
+	config->exec_cap = config->exec_count;
+	config->exec_once_cap = config->exec_once_count;
+	config->env_cap = config->env_count;
+	config->files_cap = config->files_count;
+
+	return !r->failed && r->pos == r->len;
+}
+
+// 读取过的配置文件都没有变化
+static bool config_files_unchanged(const Config *config) {
+	FileStamp stamp;
+
+	for (int i = 0; i < config->files_count; i++) {
+		const ConfigFile *file = &config->files[i];
+		if (!file->path)
+			return false;
+		file_stamp_get(file->path, &stamp);
+		if (!file_stamp_equal(&stamp, &file->stamp))
+			return false;
+	}
+	return true;
+}
+
+bool config_cache_load(Config *config, const char *config_path) {
+	char path[1024];
+	const ConfigCacheHeader *header;
+	ConfigCacheReader reader = {0};
+	Config loaded = {0};
+	FileStamp exe;
+	struct stat st;
+	void *map;
+	bool ok = false;
+	int fd;
+
+	if (!config_cache_path(config_path, path, sizeof(path), false) ||
+		!config_cache_exe_stamp(&exe))
+		return false;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return false;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*header)) {
+		close(fd);
+		return false;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	header = map;
+	if (header->magic != CONFIG_CACHE_MAGIC ||
+		header->version != CONFIG_CACHE_VERSION ||
+		header->config_size != sizeof(Config) ||
+		header->dispatcher_count != LENGTH(dispatchers) ||
+		!file_stamp_equal(&header->exe, &exe) ||
+		header->payload_size != st.st_size - sizeof(*header))
+		goto out;
+
+	reader.data = (const char *)map + sizeof(*header);
+	reader.len = header->payload_size;
+	if (config_cache_checksum(reader.data, reader.len) != header->checksum)
+		goto out;
+
+	if (!config_cache_read_payload(&reader, &loaded) ||
+		!config_files_unchanged(&loaded)) {
+		config_arena_release(&loaded.arena);
+		goto out;
+	}
+
+	config_arena_release(&config->arena);
+	*config = loaded;
+	ok = true;
+
+out:
+	munmap(map, st.st_size);
+	wlr_log(WLR_DEBUG, "config cache %s: %s", ok ? "hit" : "miss", path);
+	return ok;
+}
+
+void config_cache_save(const Config *config, const char *config_path) {
+	char path[1024], tmp_path[1100];
+	ConfigCacheWriter writer = {0};
+	ConfigCacheHeader header = {
+		.magic = CONFIG_CACHE_MAGIC,
+		.version = CONFIG_CACHE_VERSION,
+		.config_size = sizeof(Config),
+		.dispatcher_count = LENGTH(dispatchers),
+	};
+	FILE *file;
+
+	if (!config_cache_path(config_path, path, sizeof(path), true) ||
+		!config_cache_exe_stamp(&header.exe))
+		return;
+
+	config_cache_write_payload(&writer, config);
+	if (writer.failed) {
+		free(writer.data);
+		return;
+	}
+	header.payload_size = writer.len;
+	header.checksum = config_cache_checksum(writer.data, writer.len);
+
+	// 先写临时文件再改名,并发启动时不会读到写了一半的缓存
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, getpid());
+	if ((file = fopen(tmp_path, "wb"))) {
+		bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+					   fwrite(writer.data, 1, writer.len, file) == writer.len;
+		if (fclose(file) == 0 && written && rename(tmp_path, path) == 0)
+			wlr_log(WLR_DEBUG, "config cache written: %s", path);
+		else
+			unlink(tmp_path);
+	}
+	free(writer.data);
+}
@@ -566,14 +566,17 @@ void smartresizewin(const Arg *arg) {
 
 void spawn(const Arg *arg) {
 
+	pid_t pid;
+
 	if (!arg->v)
 		return;
 
-	if (fork() == 0) {
+	if ((pid = fork()) == 0) {
 		// 1. 忽略可能导致 coredump 的信号
 		signal(SIGSEGV, SIG_IGN);
 		signal(SIGABRT, SIG_IGN);
 		signal(SIGILL, SIG_IGN);
+		restore_child_signals();
 
 		dup2(STDERR_FILENO, STDOUT_FILENO);
 		setsid();
@@ -601,18 +604,13 @@ void spawn(const Arg *arg) {
 				strerror(errno));
 		_exit(EXIT_FAILURE); // 使用 _exit 避免缓冲区刷新等操作
 	}
+	if (pid > 0)
+		child_watch_add(pid, arg->v);
 }
 
 void spawn_on_empty(const Arg *arg) {
-	bool is_empty = true;
-	Client *c;
+	bool is_empty = !selmon || monitor_tags_empty(selmon, arg->ui);
 
-	wl_list_for_each(c, &clients, link) {
-		if (arg->ui & c->tags && c->mon == selmon) {
-			is_empty = false;
-			break;
-		}
-	}
 	if (!is_empty) {
 		view(arg, true);
 		return;
@@ -644,18 +642,11 @@ void switch_keyboard_layout(const Arg *arg) {
 	}
 	xkb_layout_index_t next = (current + 1) % num_layouts;
 
-	// 2. 创建上下文
-	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-	if (!context) {
-		wlr_log(WLR_ERROR, "Failed to create XKB context");
-		return;
-	}
-
-	// 3. 分配并获取布局缩写
+	// 2. 分配并获取布局缩写
 	char **layout_ids = calloc(num_layouts, sizeof(char *));
 	if (!layout_ids) {
 		wlr_log(WLR_ERROR, "Failed to allocate layout IDs");
-		goto cleanup_context;
+		return;
 	}
 
 	for (int i = 0; i < num_layouts; i++) {
@@ -667,7 +658,7 @@ void switch_keyboard_layout(const Arg *arg) {
 		}
 	}
 
-	// 4. 直接修改 rules.layout（保持原有逻辑）
+	// 3. 直接修改 rules.layout（保持原有逻辑）
 	struct xkb_rule_names rules = xkb_rules;
 	char *layout_buf = (char *)rules.layout; // 假设这是可修改的
 
@@ -698,16 +689,15 @@ void switch_keyboard_layout(const Arg *arg) {
 		}
 	}
 
-	// 5. 创建新 keymap
-	struct xkb_keymap *new_keymap =
-		xkb_keymap_new_from_names(context, &rules, XKB_KEYMAP_COMPILE_NO_FLAGS);
+	// 4. 从缓存获取新 keymap,来回切换时不再重复编译
+	struct xkb_keymap *new_keymap = keymap_cache_get(&rules);
 	if (!new_keymap) {
 		wlr_log(WLR_ERROR, "Failed to create keymap for layouts: %s",
 				rules.layout);
 		goto cleanup_layouts;
 	}
 
-	// 6. 应用新 keymap
+	// 5. 应用新 keymap
 	unsigned int depressed = keyboard->modifiers.depressed;
 	unsigned int latched = keyboard->modifiers.latched;
 	unsigned int locked = keyboard->modifiers.locked;
@@ -716,11 +706,11 @@ void switch_keyboard_layout(const Arg *arg) {
 	wlr_keyboard_notify_modifiers(keyboard, depressed, latched, locked, 0);
 	keyboard->modifiers.group = 0;
 
-	// 7. 更新 seat
+	// 6. 更新 seat
 	wlr_seat_set_keyboard(seat, keyboard);
 	wlr_seat_keyboard_notify_modifiers(seat, &keyboard->modifiers);
 
-	// 8. 清理资源
+	// 7. 清理资源
 	xkb_keymap_unref(new_keymap);
 
 cleanup_layouts:
@@ -728,9 +718,6 @@ cleanup_layouts:
 		free(layout_ids[i]);
 	}
 	free(layout_ids);
-
-cleanup_context:
-	xkb_context_unref(context);
 }
 
 void switch_layout(const Arg *arg) {
@@ -874,6 +861,7 @@ void tagsilent(const Arg *arg) {
 	Client *fc;
 	Client *target_client = selmon->sel;
 	target_client->tags = arg->ui & TAGMASK;
+	client_index_update(target_client);
 	wl_list_for_each(fc, &clients, link) {
 		if (fc && fc != target_client && target_client->tags & fc->tags &&
 			ISFULLSCREEN(fc) && !target_client->isfloating) {
@@ -1024,15 +1012,13 @@ void toggleoverlay(const Arg *arg) {
 	selmon->sel->isoverlay ^= 1;
 
 	if (selmon->sel->isoverlay) {
-		wlr_scene_node_reparent(&selmon->sel->scene->node, layers[LyrOverlay]);
-		wlr_scene_node_raise_to_top(&selmon->sel->scene->node);
+		client_set_scene_layer(selmon->sel, LyrOverlay);
+		client_raise_to_top(selmon->sel);
 	} else if (client_should_overtop(selmon->sel) && selmon->sel->isfloating) {
-		wlr_scene_node_reparent(&selmon->sel->scene->node,
-								layers[LyrFSorOverTop]);
+		client_set_scene_layer(selmon->sel, LyrFSorOverTop);
 	} else {
-		wlr_scene_node_reparent(
-			&selmon->sel->scene->node,
-			layers[selmon->sel->isfloating ? LyrFloat : LyrTile]);
+		client_set_scene_layer(selmon->sel,
+							   selmon->sel->isfloating ? LyrFloat : LyrTile);
 	}
 	setborder_color(selmon->sel);
 }
@@ -1044,6 +1030,7 @@ void toggletag(const Arg *arg) {
 	newtags = sel->tags ^ (arg->ui & TAGMASK);
 	if (newtags) {
 		sel->tags = newtags;
+		client_index_update(sel);
 		focusclient(focustop(selmon), 1);
 		arrange(selmon, false);
 	}
@@ -1122,8 +1109,6 @@ void viewtoright(const Arg *arg) {
 }
 void viewtoleft_have_client(const Arg *arg) {
 	unsigned int tmptag;
-	Client *c;
-	unsigned int found = 0;
 	unsigned int n = 1;
 	unsigned int target = selmon->tagset[selmon->seltags];
 
@@ -1132,15 +1117,8 @@ void viewtoleft_have_client(const Arg *arg) {
 	}
 
 	for (target >>= 1; target > 0 && n <= LENGTH(tags); target >>= 1, n++) {
-		wl_list_for_each(c, &clients, link) {
-			if (c->mon == selmon && target & c->tags) {
-				found = 1;
-				break;
-			}
-		}
-		if (found) {
+		if (!monitor_tags_empty(selmon, target))
 			break;
-		}
 	}
 
 	if (target == 0) {
@@ -1171,8 +1149,6 @@ void viewtoleft_have_client(const Arg *arg) {
 }
 void viewtoright_have_client(const Arg *arg) {
 	unsigned int tmptag;
-	Client *c;
-	unsigned int found = 0;
 	unsigned int n = 1;
 	unsigned int target = selmon->tagset[selmon->seltags];
 
@@ -1182,15 +1158,8 @@ void viewtoright_have_client(const Arg *arg) {
 
 	for (target <<= 1; target & TAGMASK && n <= LENGTH(tags);
 		 target <<= 1, n++) {
-		wl_list_for_each(c, &clients, link) {
-			if (c->mon == selmon && target & c->tags) {
-				found = 1;
-				break;
-			}
-		}
-		if (found) {
+		if (!monitor_tags_empty(selmon, target))
 			break;
-		}
 	}
 
 	if (!(target & TAGMASK)) {
@@ -1,4 +1,6 @@
 #include "dwl-ipc-unstable-v2-protocol.h"
+#include <inttypes.h>
+#include <stdarg.h>
 
 static void dwl_ipc_manager_bind(struct wl_client *client, void *data,
 								 unsigned int version, unsigned int id);
@@ -32,6 +34,22 @@ static void dwl_ipc_output_dispatch(struct wl_client *client,
 									const char *arg4, const char *arg5);
 static void dwl_ipc_output_release(struct wl_client *client,
 								   struct wl_resource *resource);
+static void dwl_ipc_output_register_command(
+	struct wl_client *client, struct wl_resource *resource,
+	const char *dispatch, const char *arg1, const char *arg2, const char *arg3,
+	const char *arg4, const char *arg5);
+static void dwl_ipc_output_unregister_command(struct wl_client *client,
+											  struct wl_resource *resource,
+											  unsigned int handle);
+static void dwl_ipc_output_dispatch_command(struct wl_client *client,
+											struct wl_resource *resource,
+											unsigned int handle);
+static void dwl_ipc_output_dispatch_many(struct wl_client *client,
+										 struct wl_resource *resource,
+										 struct wl_array *handles);
+static void dwl_ipc_output_query(struct wl_client *client,
+								 struct wl_resource *resource,
+								 const char *topic);
 
 /* global event handlers */
 static struct zdwl_ipc_manager_v2_interface dwl_manager_implementation = {
@@ -43,7 +61,12 @@ static struct zdwl_ipc_output_v2_interface dwl_output_implementation = {
 	.quit = dwl_ipc_output_quit,
 	.dispatch = dwl_ipc_output_dispatch,
 	.set_layout = dwl_ipc_output_set_layout,
-	.set_client_tags = dwl_ipc_output_set_client_tags};
+	.set_client_tags = dwl_ipc_output_set_client_tags,
+	.register_command = dwl_ipc_output_register_command,
+	.unregister_command = dwl_ipc_output_unregister_command,
+	.dispatch_command = dwl_ipc_output_dispatch_command,
+	.dispatch_many = dwl_ipc_output_dispatch_many,
+	.query = dwl_ipc_output_query};
 
 void dwl_ipc_manager_bind(struct wl_client *client, void *data,
 						  unsigned int version, unsigned int id) {
@@ -84,6 +107,7 @@ void dwl_ipc_manager_get_output(struct wl_client *client,
 	ipc_output = ecalloc(1, sizeof(*ipc_output));
 	ipc_output->resource = output_resource;
 	ipc_output->mon = monitor;
+	wl_list_init(&ipc_output->commands);
 	wl_resource_set_implementation(output_resource, &dwl_output_implementation,
 								   ipc_output, dwl_ipc_output_destroy);
 	wl_list_insert(&monitor->dwl_ipc_outputs, &ipc_output->link);
@@ -95,8 +119,36 @@ void dwl_ipc_manager_release(struct wl_client *client,
 	wl_resource_destroy(resource);
 }
 
+static void free_dispatch_arg(Arg *arg) {
+	free(arg->v);
+	free(arg->v2);
+	free(arg->v3);
+	arg->v = arg->v2 = arg->v3 = NULL;
+}
+
+static void ipc_command_destroy(IpcCommand *cmd) {
+	wl_list_remove(&cmd->link);
+	free_dispatch_arg(&cmd->arg);
+	free(cmd);
+}
+
+static IpcCommand *ipc_command_find(DwlIpcOutput *ipc_output,
+									uint32_t handle) {
+	IpcCommand *cmd;
+	wl_list_for_each(cmd, &ipc_output->commands, link) {
+		if (cmd->handle == handle)
+			return cmd;
+	}
+	return NULL;
+}
+
 static void dwl_ipc_output_destroy(struct wl_resource *resource) {
 	DwlIpcOutput *ipc_output = wl_resource_get_user_data(resource);
+	IpcCommand *cmd, *tmp;
+
+	wl_list_for_each_safe(cmd, tmp, &ipc_output->commands, link) {
+		ipc_command_destroy(cmd);
+	}
 	wl_list_remove(&ipc_output->link);
 	free(ipc_output);
 }
@@ -111,32 +163,32 @@ void dwl_ipc_output_printstatus_to(DwlIpcOutput *ipc_output) {
 	Monitor *monitor = ipc_output->mon;
 	Client *c, *focused;
 	int tagmask, state, numclients, focused_client, tag;
+	unsigned int urgent_tags = 0;
 	const char *title, *appid, *symbol;
 	focused = focustop(monitor);
 	zdwl_ipc_output_v2_send_active(ipc_output->resource, monitor == selmon);
 
+	// 窗口数来自tag索引,只需要遍历这个显示器上的窗口找紧急状态
+	wl_list_for_each(c, &monitor->mon_clients, mon_link) {
+		if (c->isurgent)
+			urgent_tags |= c->tags;
+	}
+
 	for (tag = 0; tag < LENGTH(tags); tag++) {
-		numclients = state = focused_client = 0;
+		state = 0;
 		tagmask = 1 << tag;
+		numclients = monitor->pertag->tag_clients[tag + 1];
+		focused_client = focused && (focused->tags & tagmask);
 		if ((tagmask & monitor->tagset[monitor->seltags]) != 0)
 			state |= ZDWL_IPC_OUTPUT_V2_TAG_STATE_ACTIVE;
-		wl_list_for_each(c, &clients, link) {
-			if (c->mon != monitor)
-				continue;
-			if (!(c->tags & tagmask))
-				continue;
-			if (c == focused)
-				focused_client = 1;
-			if (c->isurgent)
-				state |= ZDWL_IPC_OUTPUT_V2_TAG_STATE_URGENT;
-			numclients++;
-		}
+		if (urgent_tags & tagmask)
+			state |= ZDWL_IPC_OUTPUT_V2_TAG_STATE_URGENT;
 		zdwl_ipc_output_v2_send_tag(ipc_output->resource, tag, state,
 									numclients, focused_client);
 	}
 
-	title = focused ? client_get_title(focused) : "";
-	appid = focused ? client_get_appid(focused) : "";
+	title = focused ? client_published_title(focused) : "";
+	appid = focused ? client_published_appid(focused) : "";
 	symbol = monitor->pertag->ltidxs[monitor->pertag->curtag]->symbol;
 
 	zdwl_ipc_output_v2_send_layout(
@@ -206,6 +258,7 @@ void dwl_ipc_output_set_client_tags(struct wl_client *client,
 		return;
 
 	selected_client->tags = newtags;
+	client_index_update(selected_client);
 	if (selmon == monitor)
 		focusclient(focustop(monitor), 1);
 	arrange(selmon, false);
@@ -264,9 +317,260 @@ void dwl_ipc_output_dispatch(struct wl_client *client,
 	if (func) {
 		func(&arg);
 	}
+	free_dispatch_arg(&arg);
+}
+
+void dwl_ipc_output_register_command(struct wl_client *client,
+									 struct wl_resource *resource,
+									 const char *dispatch, const char *arg1,
+									 const char *arg2, const char *arg3,
+									 const char *arg4, const char *arg5) {
+	DwlIpcOutput *ipc_output = wl_resource_get_user_data(resource);
+	IpcCommand *cmd;
+
+	if (!ipc_output)
+		return;
+
+	cmd = ecalloc(1, sizeof(*cmd));
+	cmd->func =
+		parse_func_name((char *)dispatch, &cmd->arg, (char *)arg1,
+						(char *)arg2, (char *)arg3, (char *)arg4, (char *)arg5);
+	if (!cmd->func) {
+		free_dispatch_arg(&cmd->arg);
+		free(cmd);
+		zdwl_ipc_output_v2_send_command_registered(resource, 0);
+		return;
+	}
+
+	// 句柄从1开始,0留给失败
+	if (++ipc_output->next_command_handle == 0)
+		ipc_output->next_command_handle = 1;
+	cmd->handle = ipc_output->next_command_handle;
+	wl_list_insert(ipc_output->commands.prev, &cmd->link);
+	zdwl_ipc_output_v2_send_command_registered(resource, cmd->handle);
+}
+
+void dwl_ipc_output_unregister_command(struct wl_client *client,
+									   struct wl_resource *resource,
+									   unsigned int handle) {
+	DwlIpcOutput *ipc_output = wl_resource_get_user_data(resource);
+	IpcCommand *cmd;
+
+	if (!ipc_output || !(cmd = ipc_command_find(ipc_output, handle)))
+		return;
+	ipc_command_destroy(cmd);
+}
+
+void dwl_ipc_output_dispatch_command(struct wl_client *client,
+									 struct wl_resource *resource,
+									 unsigned int handle) {
+	DwlIpcOutput *ipc_output = wl_resource_get_user_data(resource);
+	IpcCommand *cmd;
+
+	if (!ipc_output || !(cmd = ipc_command_find(ipc_output, handle)))
+		return;
+	cmd->func(&cmd->arg);
+}
+
+void dwl_ipc_output_dispatch_many(struct wl_client *client,
+								  struct wl_resource *resource,
+								  struct wl_array *handles) {
+	DwlIpcOutput *ipc_output = wl_resource_get_user_data(resource);
+	IpcCommand *cmd;
+	uint32_t *handle;
+
+	if (!ipc_output)
+		return;
+
+	dispatch_batch_begin();
+	wl_array_for_each(handle, handles) {
+		if ((cmd = ipc_command_find(ipc_output, *handle)))
+			cmd->func(&cmd->arg);
+	}
+	dispatch_batch_end();
 }
 
 void dwl_ipc_output_release(struct wl_client *client,
 							struct wl_resource *resource) {
 	wl_resource_destroy(resource);
 }
+
+static void ipc_query_send(struct wl_resource *resource, const char *topic,
+						   const char *key, const char *fmt, ...) {
+	char value[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(value, sizeof(value), fmt, ap);
+	va_end(ap);
+	zdwl_ipc_output_v2_send_query_value(resource, topic, key, value);
+}
+
+static void ipc_query_xwayland(struct wl_resource *resource,
+							   const char *topic) {
+#ifdef XWAYLAND
+	pid_t pid = xwayland_server ? xwayland_server->pid : 0;
+
+	ipc_query_send(resource, topic, "enabled", "%d", xwayland != NULL);
+	if (!xwayland)
+		return;
+	ipc_query_send(resource, topic, "lazy", "%d",
+				   xwayland_server->options.lazy);
+	ipc_query_send(resource, topic, "running", "%d", pid > 0);
+	ipc_query_send(resource, topic, "pid", "%d", pid);
+	ipc_query_send(resource, topic, "starts", "%u", xwayland_stats.starts);
+	ipc_query_send(resource, topic, "prewarms", "%u",
+				   xwayland_stats.prewarms);
+	ipc_query_send(resource, topic, "last_start_latency_us", "%" PRIu64,
+				   xwayland_stats.last_latency_ns / 1000);
+	ipc_query_send(resource, topic, "max_start_latency_us", "%" PRIu64,
+				   xwayland_stats.max_latency_ns / 1000);
+	ipc_query_send(resource, topic, "rss_kb", "%ld",
+				   pid > 0 ? get_rss_kb(pid) : 0);
+#else
+	ipc_query_send(resource, topic, "enabled", "%d", 0);
+#endif
+}
+
+static void ipc_query_x11_configure(struct wl_resource *resource,
+									const char *topic) {
+#ifdef XWAYLAND
+	ipc_query_send(resource, topic, "requests", "%u", x11_configure_requests);
+	ipc_query_send(resource, topic, "absorbed", "%u", x11_configure_absorbed);
+#else
+	ipc_query_send(resource, topic, "requests", "%u", 0);
+	ipc_query_send(resource, topic, "absorbed", "%u", 0);
+#endif
+}
+
+static void ipc_query_startup(struct wl_resource *resource,
+							  const char *topic) {
+	for (int i = 0; i < startup_phase_count; i++)
+		ipc_query_send(resource, topic, startup_phases[i].name,
+					   "%" PRIu64 "%s", startup_phases[i].duration_ns / 1000,
+					   startup_phases[i].worker ? " worker" : "");
+	ipc_query_send(resource, topic, "total_us", "%" PRIu64,
+				   (startup_last_mark_ns - startup_begin_ns) / 1000);
+	ipc_query_send(resource, topic, "first_frame_us", "%" PRIu64,
+				   startup_first_frame_ns / 1000);
+}
+
+static void ipc_query_keymap_cache(struct wl_resource *resource,
+								   const char *topic) {
+	int entries = 0;
+
+	for (int i = 0; i < KEYMAP_CACHE_SIZE; i++)
+		entries += keymap_cache[i].keymap != NULL;
+	ipc_query_send(resource, topic, "entries", "%d", entries);
+	ipc_query_send(resource, topic, "hits", "%u", keymap_cache_hits);
+	ipc_query_send(resource, topic, "misses", "%u", keymap_cache_misses);
+}
+
+static void ipc_query_frame_pacing(struct wl_resource *resource,
+								   const char *topic) {
+	static const char *policies[] = {"output", "hidden", "asleep"};
+	char key[32];
+	Client *c;
+	int i = 0, rate;
+
+	ipc_query_send(resource, topic, "hidden_frame_rate", "%d",
+				   hidden_frame_rate);
+	ipc_query_send(resource, topic, "asleep_frame_rate", "%d",
+				   asleep_frame_rate);
+	wl_list_for_each(c, &clients, link) {
+		int policy = client_frame_pace(c, &rate);
+		snprintf(key, sizeof(key), "client%d", i++);
+		ipc_query_send(resource, topic, key,
+					   "appid=%s policy=%s rate_hz=%d synthetic=%u",
+					   client_published_appid(c), policies[policy], rate,
+					   c->synthetic_frames);
+	}
+}
+
+static void ipc_query_input_latency(struct wl_resource *resource,
+									const char *topic) {
+	static const char *types[] = {"key", "button", "motion", "axis"};
+
+	ipc_query_send(resource, topic, "buckets_ms",
+				   "0.5,1,2,4,8,16,32,64,128,256,512,inf");
+	for (int i = 0; i < LATENCY_TYPES; i++) {
+		LatencyHistogram *h = &input_latency[i];
+		char hist[160];
+		int len = 0;
+
+		for (int b = 0; b < LATENCY_BUCKETS; b++)
+			len += snprintf(hist + len, sizeof(hist) - len, "%s%u",
+							b ? "," : "", h->buckets[b]);
+		ipc_query_send(resource, topic, types[i],
+					   "count=%" PRIu64 " avg_us=%" PRIu64 " max_us=%" PRIu64
+					   " hist=%s",
+					   h->count, h->count ? h->sum_ns / h->count / 1000 : 0,
+					   h->max_ns / 1000, hist);
+	}
+}
+
+static void ipc_query_children(struct wl_resource *resource,
+							   const char *topic) {
+	uint64_t now = get_now_in_ns();
+	char key[32];
+
+	ipc_query_send(resource, topic, "spawned", "%u", child_stats.spawned);
+	ipc_query_send(resource, topic, "exited", "%u", child_stats.exited);
+	ipc_query_send(resource, topic, "failed", "%u", child_stats.failed);
+	ipc_query_send(resource, topic, "untracked", "%u", child_stats.untracked);
+	ipc_query_send(resource, topic, "mapped", "%u", child_stats.mapped);
+	ipc_query_send(resource, topic, "map_latency",
+				   "avg_ms=%.1f max_ms=%.1f",
+				   child_stats.mapped ? child_stats.map_latency_sum_ns /
+											child_stats.mapped / 1e6
+									  : 0.0,
+				   child_stats.map_latency_max_ns / 1e6);
+
+	// 从最旧到最新
+	for (int i = 0, n = 0; i < CHILD_WATCH_MAX; i++) {
+		ChildWatch *w =
+			&child_watches[(child_watch_next + i) % CHILD_WATCH_MAX];
+		if (!w->pid)
+			continue;
+		int exit_code = -1, exit_signal = 0;
+		if (!w->source && w->status != -1) {
+			if (WIFEXITED(w->status))
+				exit_code = WEXITSTATUS(w->status);
+			else if (WIFSIGNALED(w->status))
+				exit_signal = WTERMSIG(w->status);
+		}
+		snprintf(key, sizeof(key), "child%d", n++);
+		ipc_query_send(resource, topic, key,
+					   "pid=%d state=%s exit=%d signal=%d map_ms=%.1f "
+					   "runtime_ms=%.1f cmd=%s",
+					   w->pid, w->source ? "running" : "exited", exit_code,
+					   exit_signal,
+					   w->map_ns ? (w->map_ns - w->spawn_ns) / 1e6 : -1.0,
+					   ((w->source ? now : w->exit_ns) - w->spawn_ns) / 1e6,
+					   w->cmd);
+	}
+}
+
+static const struct {
+	const char *topic;
+	void (*func)(struct wl_resource *resource, const char *topic);
+} ipc_query_topics[] = {
+	{"xwayland", ipc_query_xwayland},
+	{"x11_configure", ipc_query_x11_configure},
+	{"startup", ipc_query_startup},
+	{"keymap_cache", ipc_query_keymap_cache},
+	{"frame_pacing", ipc_query_frame_pacing},
+	{"input_latency", ipc_query_input_latency},
+	{"children", ipc_query_children},
+};
+
+void dwl_ipc_output_query(struct wl_client *client,
+						  struct wl_resource *resource, const char *topic) {
+	for (size_t i = 0; i < LENGTH(ipc_query_topics); i++) {
+		if (strcmp(ipc_query_topics[i].topic, topic) == 0) {
+			ipc_query_topics[i].func(resource, topic);
+			break;
+		}
+	}
+	zdwl_ipc_output_v2_send_query_done(resource, topic);
+}
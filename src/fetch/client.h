@@ -112,13 +112,93 @@ setclient_coordinate_center(Client *c, struct wlr_box geom, int offsetx,
 
 	return tempbox;
 }
+/* 窗口规则的appid和title模式按配置代数编译成两个模式集合,
+ * 同一个appid/title的结果缓存起来,规则循环里逐条查询只算一次 */
+static struct {
+	PatternSet *ids;
+	PatternSet *titles;
+	unsigned int generation;
+	bool built;
+	int count;
+	unsigned char *id_hits;
+	unsigned char *title_hits;
+	char *appid;
+	char *title;
+	bool valid;
+} window_rule_matcher;
+
+void free_window_rule_matcher(void) {
+	pattern_set_destroy(window_rule_matcher.ids);
+	pattern_set_destroy(window_rule_matcher.titles);
+	free(window_rule_matcher.id_hits);
+	free(window_rule_matcher.title_hits);
+	free(window_rule_matcher.appid);
+	free(window_rule_matcher.title);
+	memset(&window_rule_matcher, 0, sizeof(window_rule_matcher));
+}
+
+static void build_window_rule_matcher(void) {
+	int i;
+
+	free_window_rule_matcher();
+	window_rule_matcher.ids = pattern_set_create();
+	window_rule_matcher.titles = pattern_set_create();
+	for (i = 0; i < config.window_rules_count; i++) {
+		pattern_set_add(window_rule_matcher.ids, config.window_rules[i].id, i);
+		pattern_set_add(window_rule_matcher.titles,
+						config.window_rules[i].title, i);
+	}
+	pattern_set_compile(window_rule_matcher.ids);
+	pattern_set_compile(window_rule_matcher.titles);
+
+	window_rule_matcher.count = config.window_rules_count;
+	window_rule_matcher.id_hits = ecalloc(MAX(1, i), 1);
+	window_rule_matcher.title_hits = ecalloc(MAX(1, i), 1);
+	window_rule_matcher.generation = config_generation;
+	window_rule_matcher.built = true;
+}
+
+static bool same_str(const char *a, const char *b) {
+	return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static void window_rules_match(const char *appid, const char *title) {
+	if (!window_rule_matcher.built ||
+		window_rule_matcher.generation != config_generation)
+		build_window_rule_matcher();
+
+	if (window_rule_matcher.valid &&
+		same_str(window_rule_matcher.appid, appid) &&
+		same_str(window_rule_matcher.title, title))
+		return;
+
+	memset(window_rule_matcher.id_hits, 0, window_rule_matcher.count);
+	memset(window_rule_matcher.title_hits, 0, window_rule_matcher.count);
+	pattern_set_match(window_rule_matcher.ids, appid,
+					  window_rule_matcher.id_hits);
+	pattern_set_match(window_rule_matcher.titles, title,
+					  window_rule_matcher.title_hits);
+
+	free(window_rule_matcher.appid);
+	free(window_rule_matcher.title);
+	window_rule_matcher.appid = appid ? strdup(appid) : NULL;
+	window_rule_matcher.title = title ? strdup(title) : NULL;
+	window_rule_matcher.valid = true;
+}
+
 /* Helper: Check if rule matches client */
 static bool is_window_rule_matches(const ConfigWinRule *r, const char *appid,
 								   const char *title) {
-	return (r->title && regex_match(r->title, title) && !r->id) ||
-		   (r->id && regex_match(r->id, appid) && !r->title) ||
-		   (r->id && regex_match(r->id, appid) && r->title &&
-			regex_match(r->title, title));
+	int i = r - config.window_rules;
+
+	window_rules_match(appid, title);
+	if (i < 0 || i >= window_rule_matcher.count)
+		return false;
+
+	return (r->title && window_rule_matcher.title_hits[i] && !r->id) ||
+		   (r->id && window_rule_matcher.id_hits[i] && !r->title) ||
+		   (r->id && window_rule_matcher.id_hits[i] && r->title &&
+			window_rule_matcher.title_hits[i]);
 }
 
 Client *center_select(Monitor *m) {
@@ -290,7 +290,7 @@ void deck(Monitor *m) {
 									.height = m->w.height - 2 * cur_gappov},
 				   0);
 			if (c == focustop(m))
-				wlr_scene_node_raise_to_top(&c->scene->node);
+				client_raise_to_top(c);
 		}
 		i++;
 	}
@@ -499,5 +499,5 @@ monocle(Monitor *m) {
 		resize(c, m->w, 0);
 	}
 	if ((c = focustop(m)))
-		wlr_scene_node_raise_to_top(&c->scene->node);
+		client_raise_to_top(c);
 }
\ No newline at end of file
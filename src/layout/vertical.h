@@ -281,7 +281,7 @@ void vertical_deck(Monitor *m) {
 											  2 * cur_gappov - cur_gappiv},
 				   0);
 			if (c == focustop(m))
-				wlr_scene_node_raise_to_top(&c->scene->node);
+				client_raise_to_top(c);
 		}
 		i++;
 	}
@@ -484,5 +484,5 @@ void vertical_monocle(Monitor *m) {
 		resize(c, m->w, 0);
 	}
 	if ((c = focustop(m)))
-		wlr_scene_node_raise_to_top(&c->scene->node);
+		client_raise_to_top(c);
 }
\ No newline at end of file
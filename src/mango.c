@@ -1,11 +1,15 @@
 /*
  * See LICENSE file for copyright and license details.
  */
+/* syscall(SYS_pidfd_open)需要 */
+#define _GNU_SOURCE
 #include "wlr-layer-shell-unstable-v1-protocol.h"
 #include "wlr/util/box.h"
+#include <errno.h>
 #include <getopt.h>
 #include <libinput.h>
 #include <limits.h>
+#include <pthread.h>
 #include <linux/input-event-codes.h>
 #include <scenefx/render/fx_renderer/fx_renderer.h>
 #include <scenefx/types/fx/blur_data.h>
@@ -17,6 +21,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
@@ -67,6 +74,7 @@
 #include <wlr/types/wlr_session_lock_v1.h>
 #include <wlr/types/wlr_single_pixel_buffer_v1.h>
 #include <wlr/types/wlr_subcompositor.h>
+#include <wlr/types/wlr_tearing_control_v1.h>
 #include <wlr/types/wlr_viewporter.h>
 #include <wlr/types/wlr_virtual_keyboard_v1.h>
 #include <wlr/types/wlr_virtual_pointer_v1.h>
@@ -87,6 +95,7 @@
 #include <wlr/xwayland.h>
 #include <xcb/xcb_icccm.h>
 #endif
+#include "common/matcher.h"
 #include "common/util.h"
 
 /* macros */
@@ -159,6 +168,16 @@ enum {
 #endif
 enum { UP, DOWN, LEFT, RIGHT, UNDIR }; /* smartmovewin */
 enum { NONE, OPEN, MOVE, CLOSE, TAG };
+enum { EffectFull, EffectLowBlur, EffectNoShadow, EffectNoAnim }; /* 特效等级 */
+enum { FRAME_PACE_OUTPUT, FRAME_PACE_HIDDEN, FRAME_PACE_ASLEEP }; /* 帧回调策略 */
+enum {
+	LATENCY_KEY,
+	LATENCY_BUTTON,
+	LATENCY_MOTION,
+	LATENCY_AXIS,
+	LATENCY_TYPES
+}; /* 输入延迟统计的事件类型 */
+enum { EffectRoleSurface, EffectRoleSubsurface, EffectRolePopup };
 
 struct dvec2 {
 	double x, y;
@@ -210,6 +229,19 @@ struct dwl_animation {
 	int action;
 };
 
+/* 边框和阴影上一次提交到scene的输入,没有变化时跳过scene设置 */
+struct decoration_state {
+	bool valid;
+	bool enabled;
+	bool grabbed;
+	bool hit_no_border;
+	int bw;
+	int radius;
+	enum corner_location corners;
+	struct wlr_box geom;
+	struct wlr_box mon_box;
+};
+
 typedef struct Pertag Pertag;
 typedef struct Monitor Monitor;
 struct wlr_foreign_toplevel_handle_v1;
@@ -250,6 +282,7 @@ struct Client {
 	struct wl_listener unmap;
 	struct wl_listener destroy;
 	struct wl_listener set_title;
+	struct wl_listener set_appid;
 	struct wl_listener fullscreen;
 #ifdef XWAYLAND
 	struct wl_listener activate;
@@ -263,6 +296,7 @@ struct Client {
 	unsigned int tags, oldtags, mini_restore_tag;
 	bool dirty;
 	unsigned int configure_serial;
+	uint64_t configure_ns; /* configure_serial发送的时间 */
 	struct wlr_foreign_toplevel_handle_v1 *foreign_toplevel;
 	int isfloating, isurgent, isfullscreen, isfakefullscreen,
 		need_float_size_reduce, isminied, isoverlay;
@@ -273,6 +307,13 @@ struct Client {
 	int overview_isfullscreenbak, overview_ismaxmizescreenbak,
 		overview_isfloatingbak;
 
+	/* 已发布给foreign-toplevel和ipc的标题/appid,按title_update_interval限频 */
+	char *published_title;
+	char *published_appid;
+	uint64_t title_published_ns;
+	struct wl_event_source *title_timer;
+	bool title_timer_armed;
+
 	struct wlr_xdg_toplevel_decoration_v1 *decoration;
 	struct wl_listener foreign_activate_request;
 	struct wl_listener foreign_fullscreen_request;
@@ -311,14 +352,59 @@ struct Client {
 	char oldmonname[128];
 	int scratchpad_width, scratchpad_height;
 	int noblur;
+	int allow_tearing;
+	int hidden_frame_rate; /* 窗口规则覆盖,-1跟随全局 */
+	uint64_t frame_done_ns;		 /* 上次合成frame done的时间 */
+	unsigned int synthetic_frames; /* 合成frame done的累计次数 */
+	struct decoration_state border_state, shadow_state;
+	struct wl_list effect_buffers; /* EffectBuffer::link */
+	bool effect_buffers_stale;
+	unsigned int effect_generation, effect_applied_generation;
+	BufferData effect_last_data;
+	bool overview_scaled; /* 表面buffer处于overview缩放状态 */
+	int scene_layer;	  /* c->scene所在的场景层 */
+	/* 按显示器和tag的窗口索引中记录的状态 */
+	struct wl_list mon_link; /* Monitor::mon_clients */
+	Monitor *index_mon;
+	unsigned int index_tags;
+	bool indexed;
 };
 
+/* 窗口表面树中的buffer节点,创建时就确定好表面角色 */
+typedef struct {
+	struct wl_list link;
+	Client *client;
+	struct wlr_scene_buffer *buffer;
+	struct wlr_surface *surface;
+	int role;
+	struct wl_listener node_destroy;
+	struct wl_listener surface_destroy;
+	struct wl_listener surface_commit;
+	struct wl_listener new_subsurface;
+	/* overview缩放前的原始位置大小和缩放后设置的值 */
+	struct wlr_box ov_base, ov_applied;
+	bool ov_scaled;
+	/* 上次应用特效时的表面大小和buffer目标大小 */
+	int applied_width, applied_height;
+	int applied_dst_width, applied_dst_height;
+} EffectBuffer;
+
 typedef struct {
 	struct wl_list link;
 	struct wl_resource *resource;
 	Monitor *mon;
+	struct wl_list commands; /* IpcCommand::link */
+	uint32_t next_command_handle;
 } DwlIpcOutput;
 
+/* 通过ipc预先解析好的dispatch命令 */
+typedef struct {
+	struct wl_list link;
+	uint32_t handle;
+	void (*func)(const Arg *);
+	Arg arg;
+} IpcCommand;
+
 typedef struct {
 	unsigned int mod;
 	xkb_keysym_t keysym;
@@ -372,9 +458,14 @@ typedef struct {
 	struct wl_listener map;
 	struct wl_listener unmap;
 	struct wl_listener surface_commit;
+	struct wl_listener new_subsurface;
 
 	struct dwl_animation animation;
 	bool dirty;
+	/* 上一次提交的布局相关状态,没有变化时不需要重新排列 */
+	struct wlr_layer_surface_v1_state last_state;
+	bool last_state_valid;
+	bool blur_dirty;
 	int noblur;
 	int noanim;
 	int noshadow;
@@ -396,6 +487,7 @@ struct Monitor {
 	struct wl_listener frame;
 	struct wl_listener destroy;
 	struct wl_listener request_state;
+	struct wl_listener present;
 	struct wl_listener destroy_lock_surface;
 	struct wlr_session_lock_surface_v1 *lock_surface;
 	struct wlr_box m;		  /* monitor area, layout-relative */
@@ -422,6 +514,15 @@ struct Monitor {
 	unsigned int visible_tiling_clients;
 	struct wlr_scene_optimized_blur *blur;
 	char last_surface_ws_name[256];
+	int effect_level; /* 当前特效降级等级 */
+	uint64_t frame_time_avg_ns, last_frame_ns; /* 提交到显示的平均延迟 */
+	uint64_t governor_commit_ns; /* 等待显示的那次提交的时间 */
+	int effect_over_frames, effect_under_frames;
+	bool arrange_deferred, arrange_deferred_animation;
+	struct wl_list mon_clients; /* Client::mon_link, 不保证堆叠顺序 */
+	/* 输入事件时间戳,等待提交(pending)和等待显示(inflight)的 */
+	uint64_t latency_pending[LATENCY_TYPES];
+	uint64_t latency_inflight[LATENCY_TYPES];
 };
 
 typedef struct {
@@ -488,6 +589,8 @@ static void cleanuplisteners(void);
 static void toggle_hotarea(int x_root, int y_root); // 触发热区
 static void maplayersurfacenotify(struct wl_listener *listener, void *data);
 static void commitlayersurfacenotify(struct wl_listener *listener, void *data);
+static void layersurfacenewsubsurface(struct wl_listener *listener,
+									  void *data);
 static void commitnotify(struct wl_listener *listener, void *data);
 static void createdecoration(struct wl_listener *listener, void *data);
 static void createidleinhibitor(struct wl_listener *listener, void *data);
@@ -557,9 +660,12 @@ static void outputmgrtest(struct wl_listener *listener, void *data);
 static void pointerfocus(Client *c, struct wlr_surface *surface, double sx,
 						 double sy, unsigned int time);
 static void printstatus(void);
+static void dispatch_batch_begin(void);
+static void dispatch_batch_end(void);
 static void quitsignal(int signo);
 static void powermgrsetmode(struct wl_listener *listener, void *data);
 static void rendermon(struct wl_listener *listener, void *data);
+static bool check_tearing_frame_allow(Monitor *m);
 static void requestdecorationmode(struct wl_listener *listener, void *data);
 static void requeststartdrag(struct wl_listener *listener, void *data);
 static void resize(Client *c, struct wlr_box geo, int interact);
@@ -583,10 +689,29 @@ static void unmaplayersurfacenotify(struct wl_listener *listener, void *data);
 static void unmapnotify(struct wl_listener *listener, void *data);
 static void updatemons(struct wl_listener *listener, void *data);
 static void updatetitle(struct wl_listener *listener, void *data);
+static void notify_input_activity(void);
+static int client_frame_pace(Client *c, int *rate);
+static int frame_pacer_timeout(void *data);
+static void frame_pacer_kick(void);
+static void input_latency_mark(Monitor *m, int type, uint32_t time_msec);
+static void outputpresent(struct wl_listener *listener, void *data);
+static void startup_mark(const char *name, bool worker, uint64_t duration_ns);
+static struct xkb_keymap *keymap_cache_get(const struct xkb_rule_names *rules);
+static void keymap_cache_clear(void);
+static void keymap_cache_update_rules(const struct xkb_rule_names *rules);
+static void start_startup_tasks(void);
+static void join_startup_tasks(void);
+static void print_startup_report(void);
+static void updateappid(struct wl_listener *listener, void *data);
+static void queue_client_title_update(Client *c);
+static void publish_client_title(Client *c);
 static void urgent(struct wl_listener *listener, void *data);
 static void view(const Arg *arg, bool want_animation);
 
-static void handlesig(int signo);
+static int handlesig(int signo, void *data);
+static void restore_child_signals(void);
+static void child_watch_add(pid_t pid, const char *cmd);
+static void child_watch_note_map(Client *c);
 
 static void virtualkeyboard(struct wl_listener *listener, void *data);
 static void virtualpointer(struct wl_listener *listener, void *data);
@@ -646,9 +771,31 @@ static void layer_actual_size(LayerSurface *l, unsigned int *width,
 							  unsigned int *height);
 static void get_layer_target_geometry(LayerSurface *l,
 									  struct wlr_box *target_box);
-static void scene_buffer_apply_effect(struct wlr_scene_buffer *buffer, int sx,
-									  int sy, void *data);
+static void scene_buffer_apply_effect(EffectBuffer *eb, BufferData *data);
+static void client_clear_effect_buffers(Client *c);
+static void client_refresh_effect_buffers(Client *c);
+static bool client_is_overview_scaled(Client *c);
+static bool client_configure_acked(Client *c);
+static void flush_interactive_grab(bool force);
+static int grab_configure_timeout(void *data);
+static void client_fit_overview_cell(Client *c);
+static void client_apply_overview_scale(Client *c);
+static void client_restore_overview_scale(Client *c);
+static void client_set_scene_layer(Client *c, int layer);
+static void client_raise_to_top(Client *c);
+static void client_sync_scene_tree(Client *c);
+static unsigned int client_owner_tag(Client *c);
+static bool client_hidden_by_tag_tree(Client *c, Monitor *m);
+static void update_tag_trees(Monitor *m, unsigned int keep_tags);
+static void destroy_tag_trees(Monitor *m);
+static void client_index_update(Client *c);
+static void client_index_add(Client *c);
+static void client_index_remove(Client *c);
+static bool monitor_tags_empty(Monitor *m, unsigned int tagmask);
 static double find_animation_curve_at(double t, int type);
+static void effect_governor_update(Monitor *m, uint64_t commit_ns,
+								   uint64_t present_ns);
+static void reset_effect_governor(void);
 
 static void apply_opacity_to_rect_nodes(Client *c, struct wlr_scene_node *node,
 										double animation_passed);
@@ -676,6 +823,8 @@ static unsigned int locked_mods = 0;
 static void *exclusive_focus;
 static struct wl_display *dpy;
 static struct wl_event_loop *event_loop;
+static int dispatch_batch_depth; /* 批量dispatch时推迟arrange和printstatus */
+static bool printstatus_deferred;
 static struct wlr_relative_pointer_manager_v1 *pointer_manager;
 static struct wlr_backend *backend;
 static struct wlr_backend *headless_backend;
@@ -700,6 +849,7 @@ static struct wlr_virtual_keyboard_manager_v1 *virtual_keyboard_mgr;
 static struct wlr_virtual_pointer_manager_v1 *virtual_pointer_mgr;
 static struct wlr_output_power_manager_v1 *power_mgr;
 static struct wlr_pointer_gestures_v1 *pointer_gestures;
+static struct wlr_tearing_control_manager_v1 *tearing_control;
 
 static struct wlr_cursor *cursor;
 static struct wlr_xcursor_manager *cursor_mgr;
@@ -722,6 +872,11 @@ static struct wl_list keyboards;
 static unsigned int cursor_mode;
 static Client *grabc;
 static int grabcx, grabcy; /* client-relative */
+/* 拖动和调整大小按帧合并,grabc->oldgeom是还没应用的目标位置 */
+#define GRAB_CONFIGURE_TIMEOUT_NS 200000000ULL /* 客户端不确认configure时最多等待 */
+static bool grab_pending;
+static bool grab_configure_forced;
+static struct wl_event_source *grab_configure_timer; /* 超时后补发被压住的configure */
 
 static struct wlr_output_layout *output_layout;
 static struct wlr_box sgeom;
@@ -745,6 +900,18 @@ struct dvec2 *baked_points_tag;
 struct dvec2 *baked_points_close;
 
 static struct wl_event_source *hide_source;
+static struct wl_event_source *frame_pacer_timer;
+
+/* 输入到画面显示的延迟直方图,桶的上限为0.5ms,1ms,2ms...512ms,最后一个桶不限 */
+#define LATENCY_BUCKETS 12
+typedef struct {
+	uint64_t count;
+	uint64_t sum_ns;
+	uint64_t max_ns;
+	uint32_t buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+static LatencyHistogram input_latency[LATENCY_TYPES];
 static bool cursor_hidden = false;
 static struct {
 	enum wp_cursor_shape_device_v1_shape shape;
@@ -763,6 +930,11 @@ struct Pertag {
 	float smfacts[LENGTH(tags) + 1]; /* smfacts per tag */
 	const Layout
 		*ltidxs[LENGTH(tags) + 1]; /* matrix of tags and layouts indexes  */
+	/* 平铺层下每个tag一个子树,切换tag时整体显示隐藏,
+	 * 下标0是多tag和全局窗口共用的子树,一直显示.
+	 * 浮动窗口之间需要跨tag叠放,仍然直接放在浮动层下 */
+	struct wlr_scene_tree *tile_trees[LENGTH(tags) + 1];
+	unsigned int tag_clients[LENGTH(tags) + 1]; /* 每个tag上的窗口数 */
 };
 
 static struct wl_listener cursor_axis = {.notify = axisnotify};
@@ -796,6 +968,80 @@ static struct wl_listener request_start_drag = {.notify = requeststartdrag};
 static struct wl_listener start_drag = {.notify = startdrag};
 static struct wl_listener new_session_lock = {.notify = locksession};
 
+static bool input_activity_seen; /* 上次检查之后是否有过输入 */
+static uint64_t idle_notify_ns;	/* 上次通知idle_notifier的时间 */
+/* 光标隐藏定时器只在到期时按最后一次活动时间重新设置 */
+static uint64_t cursor_activity_ns;
+static unsigned int hide_timer_timeout; /* 定时器设置时的超时,0表示没设置 */
+
+/* 按RMLVO缓存编译好的keymap,所有键盘组和布局切换共用 */
+#define KEYMAP_CACHE_SIZE 8
+typedef struct {
+	char key[5 * 256 + 5];
+	struct xkb_keymap *keymap;
+	uint64_t last_used;
+} KeymapCacheEntry;
+
+static struct xkb_context *keymap_cache_context;
+static KeymapCacheEntry keymap_cache[KEYMAP_CACHE_SIZE];
+static char keymap_cache_rules[5 * 256 + 5]; /* 上次配置中的xkb规则 */
+static uint64_t keymap_cache_tick;
+static uint32_t keymap_cache_hits, keymap_cache_misses;
+
+/* 启动各阶段耗时,mango -d 输出并可通过ipc查询 */
+#define STARTUP_PHASES_MAX 24
+typedef struct {
+	const char *name;
+	uint64_t duration_ns;
+	bool worker; /* 在后台线程中完成 */
+} StartupPhase;
+
+typedef struct {
+	const char *name;
+	void (*func)(void);
+	pthread_t thread;
+	bool running;
+	uint64_t duration_ns;
+} StartupTask;
+
+static uint64_t startup_begin_ns;
+static uint64_t startup_last_mark_ns;
+static uint64_t startup_first_frame_ns;
+static StartupPhase startup_phases[STARTUP_PHASES_MAX];
+static int startup_phase_count;
+static void startup_compile_keymap(void);
+static void startup_load_cursor(void);
+static void join_startup_task(StartupTask *task);
+/* spawn出来的子进程,通过pidfd在事件循环里得到退出事件 */
+#define CHILD_WATCH_MAX 32
+typedef struct {
+	pid_t pid;
+	char cmd[64];
+	uint64_t spawn_ns;
+	uint64_t map_ns;  /* 第一个窗口映射的时间,0表示还没有 */
+	uint64_t exit_ns; /* 0表示还在运行 */
+	int status;		  /* waitpid的状态,-1表示未知 */
+	struct wl_event_source *source;
+} ChildWatch;
+
+static ChildWatch child_watches[CHILD_WATCH_MAX];
+static unsigned int child_watch_next;
+static struct {
+	unsigned int spawned;
+	unsigned int exited;
+	unsigned int failed;	/* 非0退出或被信号杀死 */
+	unsigned int untracked; /* 没能用pidfd跟踪的子进程 */
+	unsigned int mapped;
+	uint64_t map_latency_sum_ns;
+	uint64_t map_latency_max_ns;
+} child_stats;
+
+static StartupTask startup_tasks[] = {
+	{"keymap", startup_compile_keymap}, /* 必须是第一个 */
+	{"cursor_theme", startup_load_cursor},
+	{"baked_points", init_baked_points},
+};
+
 #ifdef XWAYLAND
 static void activatex11(struct wl_listener *listener, void *data);
 static void configurex11(struct wl_listener *listener, void *data);
@@ -804,16 +1050,33 @@ static void dissociatex11(struct wl_listener *listener, void *data);
 static void associatex11(struct wl_listener *listener, void *data);
 static void sethints(struct wl_listener *listener, void *data);
 static void xwaylandready(struct wl_listener *listener, void *data);
+static void xwaylandserverstart(struct wl_listener *listener, void *data);
+static int xwayland_prewarm_timeout(void *data);
 static void setgeometrynotify(struct wl_listener *listener, void *data);
 static struct wl_listener new_xwayland_surface = {.notify = createnotifyx11};
 static struct wl_listener xwayland_ready = {.notify = xwaylandready};
+static struct wl_listener xwayland_server_start = {.notify =
+													   xwaylandserverstart};
 static struct wlr_xwayland *xwayland;
+static struct wlr_xwayland_server *xwayland_server;
+static struct wl_event_source *xwayland_prewarm_timer;
+static int xwayland_prewarm_fd = -1;
+static struct {
+	unsigned int starts;
+	unsigned int prewarms;
+	uint64_t start_ns; /* 正在启动时的开始时间,0表示没有在启动 */
+	uint64_t last_latency_ns;
+	uint64_t max_latency_ns;
+} xwayland_stats;
+static unsigned int x11_configure_requests;
+static unsigned int x11_configure_absorbed; /* 只重发当前几何的configure请求数 */
 #endif
 
 #include "animation/client.h"
 #include "animation/common.h"
 #include "animation/layer.h"
 #include "config/parse_config.h"
+#include "config/serialize.h"
 #include "dispatch/bind_define.h"
 #include "ext-protocol/all.h"
 #include "fetch/fetch.h"
@@ -912,6 +1175,7 @@ void swallow(Client *c, Client *w) {
 	c->scroller_proportion = w->scroller_proportion;
 	wl_list_insert(&w->link, &c->link);
 	wl_list_insert(&w->flink, &c->flink);
+	client_index_add(c);
 
 	if (w->foreign_toplevel)
 		remove_foreign_topleve(w);
@@ -994,12 +1258,128 @@ void gpureset(struct wl_listener *listener, void *data) {
 	wlr_renderer_destroy(old_drw);
 }
 
-void handlesig(int signo) {
-	if (signo == SIGCHLD)
-		while (waitpid(-1, NULL, WNOHANG) > 0)
-			;
-	else if (signo == SIGINT || signo == SIGTERM)
+static ChildWatch *child_watch_find(pid_t pid) {
+	for (int i = 0; i < CHILD_WATCH_MAX; i++) {
+		if (child_watches[i].source && child_watches[i].pid == pid)
+			return &child_watches[i];
+	}
+	return NULL;
+}
+
+static void child_watch_reaped(ChildWatch *w, int status) {
+	w->exit_ns = get_now_in_ns();
+	w->status = status;
+	wl_event_source_remove(w->source);
+	w->source = NULL;
+
+	child_stats.exited++;
+	if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status))
+		child_stats.failed++;
+	wlr_log(WLR_DEBUG, "child %d (%s) exited with status %d after %.1f ms",
+			w->pid, w->cmd, status, (w->exit_ns - w->spawn_ns) / 1e6);
+}
+
+static int child_watch_exited(int fd, uint32_t mask, void *data) {
+	ChildWatch *w = data;
+	int status;
+	pid_t pid = waitpid(w->pid, &status, WNOHANG);
+
+	if (pid == 0)
+		return 0;
+	child_watch_reaped(w, pid == w->pid ? status : -1);
+	return 0;
+}
+
+void child_watch_add(pid_t pid, const char *cmd) {
+	ChildWatch *w = NULL;
+	int fd = -1;
+
+	child_stats.spawned++;
+	/* 从最旧的槽位开始找一个已经退出的 */
+	for (int i = 0; i < CHILD_WATCH_MAX; i++) {
+		unsigned int slot = (child_watch_next + i) % CHILD_WATCH_MAX;
+		if (!child_watches[slot].source) {
+			w = &child_watches[slot];
+			child_watch_next = (slot + 1) % CHILD_WATCH_MAX;
+			break;
+		}
+	}
+
+#ifdef SYS_pidfd_open
+	if (w)
+		fd = syscall(SYS_pidfd_open, pid, 0);
+#endif
+	if (fd < 0) {
+		child_stats.untracked++;
+		return;
+	}
+
+	*w = (ChildWatch){.pid = pid, .spawn_ns = get_now_in_ns()};
+	snprintf(w->cmd, sizeof(w->cmd), "%s", cmd);
+	/* wl_event_loop_add_fd会复制fd */
+	w->source = wl_event_loop_add_fd(event_loop, fd, WL_EVENT_READABLE,
+									 child_watch_exited, w);
+	close(fd);
+	if (!w->source) {
+		w->pid = 0;
+		child_stats.untracked++;
+	}
+}
+
+// 窗口第一次映射时,沿着父进程链找到spawn它的子进程
+void child_watch_note_map(Client *c) {
+	uint64_t now = get_now_in_ns();
+	pid_t pid = c->pid;
+	bool pending = false;
+
+	for (int i = 0; i < CHILD_WATCH_MAX; i++) {
+		if (child_watches[i].source && !child_watches[i].map_ns)
+			pending = true;
+	}
+	if (!pending)
+		return;
+
+	for (int depth = 0; pid > 1 && depth < 4; depth++) {
+		ChildWatch *w = child_watch_find(pid);
+		if (w) {
+			uint64_t latency;
+			if (w->map_ns)
+				return;
+			w->map_ns = now;
+			latency = now - w->spawn_ns;
+			child_stats.mapped++;
+			child_stats.map_latency_sum_ns += latency;
+			child_stats.map_latency_max_ns =
+				MAX(child_stats.map_latency_max_ns, latency);
+			return;
+		}
+		pid = getparentprocess(pid);
+	}
+}
+
+/* 事件循环屏蔽了这些信号,子进程exec前要恢复 */
+void restore_child_signals(void) {
+	sigset_t set;
+
+	sigemptyset(&set);
+	sigprocmask(SIG_SETMASK, &set, NULL);
+}
+
+int handlesig(int signo, void *data) {
+	pid_t pid;
+	int status;
+
+	if (signo == SIGCHLD) {
+		/* 被跟踪的子进程可能在pidfd事件之前就在这里被回收 */
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+			ChildWatch *w = child_watch_find(pid);
+			if (w)
+				child_watch_reaped(w, status);
+		}
+	} else if (signo == SIGINT || signo == SIGTERM) {
 		quit(NULL);
+	}
+	return 0;
 }
 
 void toggle_hotarea(int x_root, int y_root) {
@@ -1046,6 +1426,8 @@ static void apply_rule_properties(Client *c, const ConfigWinRule *r) {
 	APPLY_INT_PROP(c, r, scratchpad_width);
 	APPLY_INT_PROP(c, r, scratchpad_height);
 	APPLY_INT_PROP(c, r, noblur);
+	APPLY_INT_PROP(c, r, allow_tearing);
+	APPLY_INT_PROP(c, r, hidden_frame_rate);
 
 	APPLY_FLOAT_PROP(c, r, scroller_proportion);
 	APPLY_FLOAT_PROP(c, r, focused_opacity);
@@ -1169,6 +1551,7 @@ void applyrules(Client *c) {
 			swallow(c, p);
 			wl_list_remove(&p->link);
 			wl_list_remove(&p->flink);
+			client_index_remove(p);
 			mon = p->mon;
 			newtags = p->tags;
 		}
@@ -1210,14 +1593,15 @@ void applyrules(Client *c) {
 
 	// apply overlay rule
 	if (c->isoverlay) {
-		wlr_scene_node_reparent(&selmon->sel->scene->node, layers[LyrOverlay]);
-		wlr_scene_node_raise_to_top(&selmon->sel->scene->node);
+		client_set_scene_layer(selmon->sel, LyrOverlay);
+		client_raise_to_top(selmon->sel);
 	}
 }
 
 void // 17
 arrange(Monitor *m, bool want_animation) {
-	Client *c;
+	Client *c, *tmp;
+	unsigned int tagouting_tags = 0;
 
 	if (!m)
 		return;
@@ -1225,18 +1609,29 @@ arrange(Monitor *m, bool want_animation) {
 	if (!m->wlr_output->enabled)
 		return;
 
+	if (dispatch_batch_depth > 0) {
+		m->arrange_deferred = true;
+		m->arrange_deferred_animation |= want_animation;
+		return;
+	}
+
 	m->visible_clients = 0;
 	m->visible_tiling_clients = 0;
-	wl_list_for_each(c, &clients, link) {
+	// 只需要遍历这个显示器上的窗口
+	wl_list_for_each_safe(c, tmp, &m->mon_clients, mon_link) {
 		if (c->iskilling)
 			continue;
 
 		if (c->mon == m && (c->isglobal || c->isunglobal)) {
 			c->tags = m->tagset[m->seltags];
+			client_index_update(c);
 			if (selmon->sel == NULL)
 				focusclient(c, 0);
 		}
 
+		if (c->mon == m)
+			client_sync_scene_tree(c);
+
 		if (c->mon == m) {
 			if (VISIBLEON(c, m)) {
 
@@ -1305,6 +1700,9 @@ arrange(Monitor *m, bool want_animation) {
 					animations) {
 					c->animation.tagouting = true;
 					c->animation.tagining = false;
+					// 只保留窗口所在的tag子树,共享子树一直显示
+					if (client_hidden_by_tag_tree(c, m))
+						tagouting_tags |= 1 << (client_owner_tag(c) - 1);
 					if (m->pertag->curtag > m->pertag->prevtag) {
 						c->pending = c->geom;
 						c->pending.x = tag_animation_direction == VERTICAL
@@ -1326,7 +1724,9 @@ arrange(Monitor *m, bool want_animation) {
 						resize(c, c->geom, 0);
 					}
 				} else {
-					wlr_scene_node_set_enabled(&c->scene->node, false);
+					// 所在的tag子树会整体隐藏时不需要单独修改窗口节点
+					if (!client_hidden_by_tag_tree(c, m))
+						wlr_scene_node_set_enabled(&c->scene->node, false);
 					client_set_suspended(c, true);
 				}
 			}
@@ -1338,6 +1738,18 @@ arrange(Monitor *m, bool want_animation) {
 		}
 	}
 
+	// 只为移出动画保留的子树里,其他窗口不能跟着显示出来
+	if (tagouting_tags) {
+		wl_list_for_each(c, &m->mon_clients, mon_link) {
+			if (c->mon == m && !c->animation.tagouting &&
+				client_hidden_by_tag_tree(c, m) &&
+				(tagouting_tags & (1 << (client_owner_tag(c) - 1))))
+				wlr_scene_node_set_enabled(&c->scene->node, false);
+		}
+	}
+
+	update_tag_trees(m, tagouting_tags);
+
 	if (m->isoverview) {
 		overviewlayout.arrange(m);
 	} else if (m && m->pertag->ltidxs[m->pertag->curtag]->arrange) {
@@ -1346,6 +1758,7 @@ arrange(Monitor *m, bool want_animation) {
 
 	motionnotify(0, NULL, 0, 0, 0, 0);
 	checkidleinhibitor(NULL);
+	frame_pacer_kick();
 }
 
 void arrangelayer(Monitor *m, struct wl_list *list, struct wlr_box *usable_area,
@@ -1535,7 +1948,9 @@ axisnotify(struct wl_listener *listener, void *data) {
 	unsigned int adir;
 	// IDLE_NOTIFY_ACTIVITY;
 	handlecursoractivity();
-	wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
+	notify_input_activity();
+	input_latency_mark(xytomon(cursor->x, cursor->y), LATENCY_AXIS,
+					   event->time_msec);
 	keyboard = wlr_seat_get_keyboard(seat);
 
 	// 获取当前按键的mask,比如alt+super或者alt+ctrl
@@ -1735,7 +2150,9 @@ buttonpress(struct wl_listener *listener, void *data) {
 		seat->pointer_state.focused_surface;
 
 	handlecursoractivity();
-	wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
+	notify_input_activity();
+	input_latency_mark(xytomon(cursor->x, cursor->y), LATENCY_BUTTON,
+					   event->time_msec);
 
 	switch (event->state) {
 	case WL_POINTER_BUTTON_STATE_PRESSED:
@@ -1786,6 +2203,8 @@ buttonpress(struct wl_listener *listener, void *data) {
 	case WL_POINTER_BUTTON_STATE_RELEASED:
 		/* If you released any buttons, we exit interactive move/resize mode. */
 		if (!locked && cursor_mode != CurNormal && cursor_mode != CurPressed) {
+			/* 松开时最后的大小不受configure节流限制 */
+			flush_interactive_grab(true);
 			cursor_mode = CurNormal;
 			/* Clear the pointer focus, this way if the cursor is over a surface
 			 * we will send an enter event after which the client will provide
@@ -1889,14 +2308,27 @@ void cleanuplisteners(void) {
 #ifdef XWAYLAND
 	wl_list_remove(&new_xwayland_surface.link);
 	wl_list_remove(&xwayland_ready.link);
+	if (xwayland_server)
+		wl_list_remove(&xwayland_server_start.link);
 #endif
 }
 
 void cleanup(void) {
 	cleanuplisteners();
+	finish_config_reload();
 #ifdef XWAYLAND
+	if (xwayland_prewarm_timer) {
+		wl_event_source_remove(xwayland_prewarm_timer);
+		xwayland_prewarm_timer = NULL;
+	}
+	if (xwayland_prewarm_fd >= 0) {
+		close(xwayland_prewarm_fd);
+		xwayland_prewarm_fd = -1;
+	}
 	wlr_xwayland_destroy(xwayland);
 	xwayland = NULL;
+	wlr_xwayland_server_destroy(xwayland_server);
+	xwayland_server = NULL;
 #endif
 
 	wl_display_destroy_clients(dpy);
@@ -1905,6 +2337,14 @@ void cleanup(void) {
 		waitpid(child_pid, NULL, 0);
 	}
 	wlr_xcursor_manager_destroy(cursor_mgr);
+	if (frame_pacer_timer) {
+		wl_event_source_remove(frame_pacer_timer);
+		frame_pacer_timer = NULL;
+	}
+	if (grab_configure_timer) {
+		wl_event_source_remove(grab_configure_timer);
+		grab_configure_timer = NULL;
+	}
 
 	destroykeyboardgroup(&kb_group->destroy, NULL);
 
@@ -1918,6 +2358,12 @@ void cleanup(void) {
 	/* Destroy after the wayland display (when the monitors are already
 	   destroyed) to avoid destroying them with an invalid scene output. */
 	wlr_scene_node_destroy(&scene->tree.node);
+
+	keymap_cache_clear();
+	if (keymap_cache_context)
+		xkb_context_unref(keymap_cache_context);
+	free_config();
+	free_window_rule_matcher();
 }
 
 void // 17
@@ -1945,6 +2391,7 @@ void cleanupmon(struct wl_listener *listener, void *data) {
 
 	wl_list_remove(&m->destroy.link);
 	wl_list_remove(&m->frame.link);
+	wl_list_remove(&m->present.link);
 	wl_list_remove(&m->link);
 	wl_list_remove(&m->request_state.link);
 	if (m->lock_surface)
@@ -1958,6 +2405,7 @@ void cleanupmon(struct wl_listener *listener, void *data) {
 		wlr_scene_node_destroy(&m->blur->node);
 		m->blur = NULL;
 	}
+	destroy_tag_trees(m);
 	free(m);
 }
 
@@ -1983,6 +2431,7 @@ void closemon(Monitor *m) {
 			if (selmon == NULL) {
 				remove_foreign_topleve(c);
 				c->mon = NULL;
+				client_index_update(c);
 			} else {
 				client_change_mon(c, selmon);
 			}
@@ -2035,6 +2484,7 @@ void maplayersurfacenotify(struct wl_listener *listener, void *data) {
 
 	l->noanim = 0;
 	l->dirty = false;
+	l->blur_dirty = true;
 	l->noblur = 0;
 	l->shadow = NULL;
 	l->need_output_flush = true;
@@ -2084,6 +2534,34 @@ void maplayersurfacenotify(struct wl_listener *listener, void *data) {
 	}
 }
 
+void layersurfacenewsubsurface(struct wl_listener *listener, void *data) {
+	LayerSurface *l = wl_container_of(listener, l, new_subsurface);
+	// 新的子表面需要重新设置模糊
+	l->blur_dirty = true;
+}
+
+bool layer_state_update(LayerSurface *l) {
+	const struct wlr_layer_surface_v1_state *state =
+		&l->layer_surface->current;
+	const struct wlr_layer_surface_v1_state *old = &l->last_state;
+
+	if (l->last_state_valid && old->anchor == state->anchor &&
+		old->exclusive_zone == state->exclusive_zone &&
+		old->margin.top == state->margin.top &&
+		old->margin.right == state->margin.right &&
+		old->margin.bottom == state->margin.bottom &&
+		old->margin.left == state->margin.left &&
+		old->desired_width == state->desired_width &&
+		old->desired_height == state->desired_height &&
+		old->layer == state->layer &&
+		old->keyboard_interactive == state->keyboard_interactive)
+		return false;
+
+	l->last_state = *state;
+	l->last_state_valid = true;
+	return true;
+}
+
 void commitlayersurfacenotify(struct wl_listener *listener, void *data) {
 	LayerSurface *l = wl_container_of(listener, l, surface_commit);
 	struct wlr_layer_surface_v1 *layer_surface = l->layer_surface;
@@ -2091,6 +2569,7 @@ void commitlayersurfacenotify(struct wl_listener *listener, void *data) {
 		layers[layermap[layer_surface->current.layer]];
 	struct wlr_layer_surface_v1_state old_state;
 	struct wlr_box box;
+	bool state_changed;
 
 	if (l->layer_surface->initial_commit) {
 		client_set_scale(layer_surface->surface, l->mon->wlr_output->scale);
@@ -2105,6 +2584,9 @@ void commitlayersurfacenotify(struct wl_listener *listener, void *data) {
 		return;
 	}
 
+	// 只是内容更新的提交(比如时钟)不需要重新排列和设置模糊
+	state_changed = layer_state_update(l);
+
 	get_layer_target_geometry(l, &box);
 
 	if (animations && layer_animations && !l->noanim && l->mapped &&
@@ -2122,8 +2604,9 @@ void commitlayersurfacenotify(struct wl_listener *listener, void *data) {
 		layer_set_pending_state(l);
 	}
 
-	if (blur && blur_layer) {
+	if (blur && blur_layer && (state_changed || l->blur_dirty)) {
 		// 设置非背景layer模糊
+		l->blur_dirty = false;
 
 		if (!l->noblur &&
 			layer_surface->current.layer != ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM &&
@@ -2150,8 +2633,7 @@ void commitlayersurfacenotify(struct wl_listener *listener, void *data) {
 			ZWLR_LAYER_SURFACE_V1_KEYBOARD_INTERACTIVITY_EXCLUSIVE)
 		exclusive_focus = NULL;
 
-	if (layer_surface->current.committed == 0 &&
-		l->mapped == layer_surface->surface->mapped)
+	if (!state_changed && l->mapped == layer_surface->surface->mapped)
 		return;
 	l->mapped = layer_surface->surface->mapped;
 
@@ -2204,8 +2686,23 @@ void commitnotify(struct wl_listener *listener, void *data) {
 		c->animation.tagining)
 		return;
 
-	if (c == grabc || !c->dirty)
+	/* 调整大小时客户端提交了新的buffer,下一帧再发下一个configure */
+	if (c == grabc) {
+		if (cursor_mode == CurResize && c->mon) {
+			grab_pending = true;
+			wlr_output_schedule_frame(c->mon->wlr_output);
+		}
+		return;
+	}
+
+	if (!c->dirty)
+		return;
+
+	/* overview中不给窗口发configure,画面缩放在effect_buffer_surface_commit里更新 */
+	if (c->mon && c->mon->isoverview && ov_scale_buffers) {
+		c->dirty = false;
 		return;
+	}
 
 	resize(c, c->geom, 0);
 
@@ -2280,18 +2777,81 @@ void createkeyboard(struct wlr_keyboard *keyboard) {
 	wlr_keyboard_group_add_keyboard(kb_group->wlr_group, keyboard);
 }
 
+static void keymap_cache_key(const struct xkb_rule_names *rules, char *buf,
+							 size_t size) {
+	snprintf(buf, size, "%s\x1f%s\x1f%s\x1f%s\x1f%s",
+			 rules->rules ? rules->rules : "", rules->model ? rules->model : "",
+			 rules->layout ? rules->layout : "",
+			 rules->variant ? rules->variant : "",
+			 rules->options ? rules->options : "");
+}
+
+/* 返回的keymap带有一个引用,调用者负责unref */
+struct xkb_keymap *keymap_cache_get(const struct xkb_rule_names *rules) {
+	char key[sizeof(keymap_cache[0].key)];
+	KeymapCacheEntry *slot = &keymap_cache[0];
+
+	keymap_cache_key(rules, key, sizeof(key));
+	for (int i = 0; i < KEYMAP_CACHE_SIZE; i++) {
+		KeymapCacheEntry *entry = &keymap_cache[i];
+		if (entry->keymap && strcmp(entry->key, key) == 0) {
+			entry->last_used = ++keymap_cache_tick;
+			keymap_cache_hits++;
+			return xkb_keymap_ref(entry->keymap);
+		}
+		/* 优先用空位,否则淘汰最久未使用的 */
+		if (!entry->keymap ||
+			(slot->keymap && entry->last_used < slot->last_used))
+			slot = entry;
+	}
+
+	keymap_cache_misses++;
+	if (!keymap_cache_context &&
+		!(keymap_cache_context = xkb_context_new(XKB_CONTEXT_NO_FLAGS)))
+		return NULL;
+
+	struct xkb_keymap *keymap = xkb_keymap_new_from_names(
+		keymap_cache_context, rules, XKB_KEYMAP_COMPILE_NO_FLAGS);
+	if (!keymap)
+		return NULL;
+
+	if (slot->keymap)
+		xkb_keymap_unref(slot->keymap);
+	snprintf(slot->key, sizeof(slot->key), "%s", key);
+	slot->keymap = xkb_keymap_ref(keymap);
+	slot->last_used = ++keymap_cache_tick;
+	return keymap;
+}
+
+void keymap_cache_clear(void) {
+	for (int i = 0; i < KEYMAP_CACHE_SIZE; i++) {
+		if (keymap_cache[i].keymap)
+			xkb_keymap_unref(keymap_cache[i].keymap);
+		keymap_cache[i].keymap = NULL;
+	}
+}
+
+/* 只有配置里的xkb规则变化时才清空缓存,布局切换产生的keymap保留 */
+void keymap_cache_update_rules(const struct xkb_rule_names *rules) {
+	char key[sizeof(keymap_cache_rules)];
+
+	keymap_cache_key(rules, key, sizeof(key));
+	if (strcmp(key, keymap_cache_rules) == 0)
+		return;
+	keymap_cache_clear();
+	snprintf(keymap_cache_rules, sizeof(keymap_cache_rules), "%s", key);
+}
+
 KeyboardGroup *createkeyboardgroup(void) {
 	KeyboardGroup *group = ecalloc(1, sizeof(*group));
-	struct xkb_context *context;
 	struct xkb_keymap *keymap;
 
 	group->wlr_group = wlr_keyboard_group_create();
 	group->wlr_group->data = group;
 
 	/* Prepare an XKB keymap and assign it to the keyboard group. */
-	context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-	if (!(keymap = xkb_keymap_new_from_names(context, &xkb_rules,
-											 XKB_KEYMAP_COMPILE_NO_FLAGS)))
+	join_startup_task(&startup_tasks[0]);
+	if (!(keymap = keymap_cache_get(&xkb_rules)))
 		die("failed to compile keymap");
 
 	wlr_keyboard_set_keymap(&group->wlr_group->keyboard, keymap);
@@ -2315,7 +2875,6 @@ KeyboardGroup *createkeyboardgroup(void) {
 									  locked_mods, 0);
 
 	xkb_keymap_unref(keymap);
-	xkb_context_unref(context);
 
 	wlr_keyboard_set_repeat_info(&group->wlr_group->keyboard, repeat_rate,
 								 repeat_delay);
@@ -2358,6 +2917,8 @@ void createlayersurface(struct wl_listener *listener, void *data) {
 	LISTEN(&surface->events.unmap, &l->unmap, unmaplayersurfacenotify);
 	LISTEN(&layer_surface->events.destroy, &l->destroy,
 		   destroylayersurfacenotify);
+	LISTEN(&surface->events.new_subsurface, &l->new_subsurface,
+		   layersurfacenewsubsurface);
 
 	l->layer_surface = layer_surface;
 	l->mon = layer_surface->output->data;
@@ -2474,6 +3035,7 @@ void createmon(struct wl_listener *listener, void *data) {
 
 	/* Set up event listeners */
 	LISTEN(&wlr_output->events.frame, &m->frame, rendermon);
+	LISTEN(&wlr_output->events.present, &m->present, outputpresent);
 	LISTEN(&wlr_output->events.destroy, &m->destroy, cleanupmon);
 	LISTEN(&wlr_output->events.request_state, &m->request_state,
 		   requestmonstate);
@@ -2483,6 +3045,7 @@ void createmon(struct wl_listener *listener, void *data) {
 	wlr_output_state_finish(&state);
 
 	wl_list_insert(&mons, &m->link);
+	wl_list_init(&m->mon_clients);
 	m->pertag = calloc(1, sizeof(Pertag));
 	m->pertag->curtag = m->pertag->prevtag = 1;
 
@@ -2491,7 +3054,9 @@ void createmon(struct wl_listener *listener, void *data) {
 		m->pertag->mfacts[i] = m->mfact;
 		m->pertag->smfacts[i] = default_smfact;
 		m->pertag->ltidxs[i] = m->lt;
+		m->pertag->tile_trees[i] = wlr_scene_tree_create(layers[LyrTile]);
 	}
+	update_tag_trees(m, 0);
 
 	// apply tag rule
 	for (i = 1; i <= config.tag_rules_count; i++) {
@@ -2561,6 +3126,7 @@ createnotify(struct wl_listener *listener, void *data) {
 	LISTEN(&toplevel->events.request_maximize, &c->maximize, maximizenotify);
 	LISTEN(&toplevel->events.request_minimize, &c->minimize, minimizenotify);
 	LISTEN(&toplevel->events.set_title, &c->set_title, updatetitle);
+	LISTEN(&toplevel->events.set_app_id, &c->set_appid, updateappid);
 }
 
 void createpointer(struct wlr_pointer *pointer) {
@@ -2692,6 +3258,7 @@ void destroylayersurfacenotify(struct wl_listener *listener, void *data) {
 	wl_list_remove(&l->map.link);
 	wl_list_remove(&l->unmap.link);
 	wl_list_remove(&l->surface_commit.link);
+	wl_list_remove(&l->new_subsurface.link);
 	wlr_scene_node_destroy(&l->scene->node);
 	wlr_scene_node_destroy(&l->popups->node);
 	free(l);
@@ -2751,6 +3318,7 @@ destroynotify(struct wl_listener *listener, void *data) {
 	Client *c = wl_container_of(listener, c, destroy);
 	wl_list_remove(&c->destroy.link);
 	wl_list_remove(&c->set_title.link);
+	wl_list_remove(&c->set_appid.link);
 	wl_list_remove(&c->fullscreen.link);
 	wl_list_remove(&c->maximize.link);
 	wl_list_remove(&c->minimize.link);
@@ -2768,6 +3336,10 @@ destroynotify(struct wl_listener *listener, void *data) {
 		wl_list_remove(&c->map.link);
 		wl_list_remove(&c->unmap.link);
 	}
+	if (c->title_timer)
+		wl_event_source_remove(c->title_timer);
+	free(c->published_title);
+	free(c->published_appid);
 	free(c);
 }
 
@@ -2821,7 +3393,7 @@ void focusclient(Client *c, int lift) {
 
 	/* Raise client in stacking order if requested */
 	if (c && lift)
-		wlr_scene_node_raise_to_top(&c->scene->node); // 将视图提升到顶层
+		client_raise_to_top(c); // 将视图提升到顶层
 
 	if (c && client_surface(c) == old_keyboard_focus_surface && selmon &&
 		selmon->sel)
@@ -3032,13 +3604,10 @@ bool keypressglobal(struct wlr_surface *last_surface,
 			r->globalkeybinding.mod == mods) {
 			wl_list_for_each(c, &clients, link) {
 				if (c && c != lastc) {
-					appid = client_get_appid(c);
-					title = client_get_title(c);
+					appid = client_published_appid(c);
+					title = client_published_title(c);
 
-					if ((r->title && regex_match(r->title, title) && !r->id) ||
-						(r->id && regex_match(r->id, appid) && !r->title) ||
-						(r->id && regex_match(r->id, appid) && r->title &&
-						 regex_match(r->title, title))) {
+					if (is_window_rule_matches(r, appid, title)) {
 						reset = true;
 						wlr_seat_keyboard_enter(seat, client_surface(c),
 												keycodes, 0,
@@ -3088,7 +3657,8 @@ void keypress(struct wl_listener *listener, void *data) {
 	int handled = 0;
 	unsigned int mods = wlr_keyboard_get_modifiers(&group->wlr_group->keyboard);
 
-	wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
+	notify_input_activity();
+	input_latency_mark(selmon, LATENCY_KEY, event->time_msec);
 
 	// ov tab mode detect moe key release
 	if (ov_tab_mode && !locked &&
@@ -3246,6 +3816,8 @@ void init_client_properties(Client *c) {
 	c->no_force_center = 0;
 	c->scratchpad_width = 0;
 	c->scratchpad_height = 0;
+	c->allow_tearing = allow_tearing;
+	c->hidden_frame_rate = -1;
 }
 
 void // old fix to 0.5
@@ -3255,12 +3827,15 @@ mapnotify(struct wl_listener *listener, void *data) {
 	Client *c = wl_container_of(listener, c, map);
 	/* Create scene tree for this client and its border */
 	c->scene = client_surface(c)->data = wlr_scene_tree_create(layers[LyrTile]);
+	c->scene_layer = LyrTile;
 	wlr_scene_node_set_enabled(&c->scene->node, c->type != XDGShell);
 	c->scene_surface =
 		c->type == XDGShell
 			? wlr_scene_xdg_surface_create(c->scene, c->surface.xdg)
 			: wlr_scene_subsurface_tree_create(c->scene, client_surface(c));
 	c->scene->node.data = c->scene_surface->node.data = c;
+	wl_list_init(&c->effect_buffers);
+	c->effect_buffers_stale = true;
 
 	client_get_geometry(c, &c->geom);
 
@@ -3285,7 +3860,7 @@ mapnotify(struct wl_listener *listener, void *data) {
 	/* Handle unmanaged clients first so we can return prior create borders */
 	if (client_is_unmanaged(c)) {
 		/* Unmanaged clients always are floating */
-		wlr_scene_node_reparent(&c->scene->node, layers[LyrFSorOverTop]);
+		client_set_scene_layer(c, LyrFSorOverTop);
 		wlr_scene_node_set_position(&c->scene->node, c->geom.x, c->geom.y);
 		if (client_wants_focus(c)) {
 			focusclient(c, 1);
@@ -3314,6 +3889,8 @@ mapnotify(struct wl_listener *listener, void *data) {
 
 	wlr_scene_node_lower_to_bottom(&c->shadow->node);
 	wlr_scene_node_set_enabled(&c->shadow->node, true);
+	c->border_state.valid = false;
+	c->shadow_state.valid = false;
 
 	/* Initialize client geometry with room for border */
 	client_set_tiled(c, WLR_EDGE_TOP | WLR_EDGE_BOTTOM | WLR_EDGE_LEFT |
@@ -3331,6 +3908,7 @@ mapnotify(struct wl_listener *listener, void *data) {
 	} else
 		wl_list_insert(clients.prev, &c->link); // 尾部入栈
 	wl_list_insert(&fstack, &c->flink);
+	client_index_add(c);
 
 	/* Set initial monitor, tags, floating status, and focus:
 	 * we always consider floating, clients that have parent and thus
@@ -3353,6 +3931,7 @@ mapnotify(struct wl_listener *listener, void *data) {
 	// make sure the animation is open type
 	c->is_pending_open_animation = true;
 	resize(c, c->geom, 0);
+	child_watch_note_map(c);
 	printstatus();
 }
 
@@ -3391,6 +3970,7 @@ void set_minized(Client *c) {
 	c->oldtags = c->mon->tagset[c->mon->seltags];
 	c->mini_restore_tag = c->tags;
 	c->tags = 0;
+	client_index_update(c);
 	c->isminied = 1;
 	c->is_in_scratchpad = 1;
 	c->is_scratchpad_show = 0;
@@ -3508,25 +4088,30 @@ void motionnotify(unsigned int time, struct wlr_input_device *device, double dx,
 
 		wlr_cursor_move(cursor, device, dx, dy);
 		handlecursoractivity();
-		wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
+		notify_input_activity();
 
 		/* Update selmon (even while dragging a window) */
 		if (sloppyfocus)
 			selmon = xytomon(cursor->x, cursor->y);
+		input_latency_mark(xytomon(cursor->x, cursor->y), LATENCY_MOTION,
+						   time);
 	}
 
 	/* Update drag icon's position */
 	wlr_scene_node_set_position(&drag_icon->node, (int)round(cursor->x),
 								(int)round(cursor->y));
 
-	/* If we are currently grabbing the mouse, handle and return */
+	/* If we are currently grabbing the mouse, handle and return.
+	 * 只记录目标位置大小,在下一帧开始时统一应用 */
 	if (cursor_mode == CurMove) {
 		/* Move the grabbed client to the new position. */
 		grabc->oldgeom = (struct wlr_box){.x = (int)round(cursor->x) - grabcx,
 										  .y = (int)round(cursor->y) - grabcy,
 										  .width = grabc->geom.width,
 										  .height = grabc->geom.height};
-		resize(grabc, grabc->oldgeom, 1);
+		grab_pending = true;
+		if (grabc->mon)
+			wlr_output_schedule_frame(grabc->mon->wlr_output);
 		return;
 	} else if (cursor_mode == CurResize) {
 		grabc->oldgeom =
@@ -3534,7 +4119,9 @@ void motionnotify(unsigned int time, struct wlr_input_device *device, double dx,
 							 .y = grabc->geom.y,
 							 .width = (int)round(cursor->x) - grabc->geom.x,
 							 .height = (int)round(cursor->y) - grabc->geom.y};
-		resize(grabc, grabc->oldgeom, 1);
+		grab_pending = true;
+		if (grabc->mon)
+			wlr_output_schedule_frame(grabc->mon->wlr_output);
 		return;
 	}
 
@@ -3691,6 +4278,12 @@ void pointerfocus(Client *c, struct wlr_surface *surface, double sx, double sy,
 void // 17
 printstatus(void) {
 	Monitor *m = NULL;
+
+	if (dispatch_batch_depth > 0) {
+		printstatus_deferred = true;
+		return;
+	}
+
 	wl_list_for_each(m, &mons, link) {
 		if (!m->wlr_output->enabled) {
 			continue;
@@ -3699,6 +4292,29 @@ printstatus(void) {
 	}
 }
 
+void dispatch_batch_begin(void) { dispatch_batch_depth++; }
+
+void dispatch_batch_end(void) {
+	Monitor *m;
+
+	if (--dispatch_batch_depth > 0)
+		return;
+
+	// 批量命令执行完后每个显示器只排列一次
+	wl_list_for_each(m, &mons, link) {
+		if (!m->arrange_deferred)
+			continue;
+		m->arrange_deferred = false;
+		arrange(m, m->arrange_deferred_animation);
+		m->arrange_deferred_animation = false;
+	}
+
+	if (printstatus_deferred) {
+		printstatus_deferred = false;
+		printstatus();
+	}
+}
+
 void powermgrsetmode(struct wl_listener *listener, void *data) {
 	struct wlr_output_power_v1_set_mode_event *event = data;
 	struct wlr_output_state state = {0};
@@ -3713,6 +4329,7 @@ void powermgrsetmode(struct wl_listener *listener, void *data) {
 
 	m->asleep = !event->mode;
 	updatemons(NULL, NULL);
+	frame_pacer_kick();
 }
 
 void quitsignal(int signo) { quit(NULL); }
@@ -3727,6 +4344,152 @@ void client_set_opacity(Client *c, double opacity) {
 								   scene_buffer_apply_opacity, &opacity);
 }
 
+bool check_tearing_frame_allow(Monitor *m) {
+	Client *c = focustop(m);
+
+	/* 只有当前显示器顶层的全屏窗口可以撕裂 */
+	if (!c || !c->isfullscreen || c->allow_tearing <= 0 ||
+		!client_surface(c)->mapped)
+		return false;
+
+	/* allow_tearing:2 无视客户端的提示强制撕裂 */
+	if (c->allow_tearing == 2)
+		return true;
+
+	return wlr_tearing_control_manager_v1_surface_hint_from_surface(
+			   tearing_control, client_surface(c)) ==
+		   WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC;
+}
+
+/* 不在输出上显示的窗口不会收到frame done,按策略合成低频的frame done,
+ * 返回值为策略类型,rate为对应的每秒次数 */
+int client_frame_pace(Client *c, int *rate) {
+	if (c->mon && (c->mon->asleep || !c->mon->wlr_output->enabled)) {
+		*rate = c->hidden_frame_rate >= 0 ? c->hidden_frame_rate
+										  : asleep_frame_rate;
+		return FRAME_PACE_ASLEEP;
+	}
+	int x, y;
+	if (!c->mon || !wlr_scene_node_coords(&c->scene->node, &x, &y)) {
+		*rate = c->hidden_frame_rate >= 0 ? c->hidden_frame_rate
+										  : hidden_frame_rate;
+		return FRAME_PACE_HIDDEN;
+	}
+	*rate = (c->mon->wlr_output->refresh + 500) / 1000;
+	return FRAME_PACE_OUTPUT;
+}
+
+static void send_frame_done_iterator(struct wlr_surface *surface, int sx,
+									 int sy, void *data) {
+	wlr_surface_send_frame_done(surface, data);
+}
+
+int frame_pacer_timeout(void *data) {
+	uint64_t now_ns = get_now_in_ns();
+	uint64_t next_ns = UINT64_MAX;
+	struct wlr_surface *surface;
+	struct timespec now;
+	Client *c;
+	int rate;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	wl_list_for_each(c, &clients, link) {
+		surface = client_surface(c);
+		if (c->iskilling || !surface || !surface->mapped)
+			continue;
+		if (client_frame_pace(c, &rate) == FRAME_PACE_OUTPUT || rate <= 0)
+			continue;
+
+		uint64_t interval = 1000000000ULL / rate;
+		if (now_ns - c->frame_done_ns >= interval) {
+			wlr_surface_for_each_surface(surface, send_frame_done_iterator,
+										 &now);
+			c->frame_done_ns = now_ns;
+			c->synthetic_frames++;
+		}
+		next_ns = MIN(next_ns, c->frame_done_ns + interval);
+	}
+
+	/* 没有需要合成frame done的窗口时停止定时器,等下次arrange再启动 */
+	if (next_ns != UINT64_MAX)
+		wl_event_source_timer_update(
+			frame_pacer_timer, MAX(1, (int)((next_ns - now_ns) / 1000000)));
+	return 0;
+}
+
+void frame_pacer_kick(void) {
+	if (frame_pacer_timer)
+		wl_event_source_timer_update(frame_pacer_timer, 1);
+}
+
+/* 记录每类输入中最早一个还没反映到画面上的事件,time_msec是libinput时间戳 */
+void input_latency_mark(Monitor *m, int type, uint32_t time_msec) {
+	uint64_t now_ms, event_ms;
+
+	if (!m || !time_msec || m->latency_pending[type])
+		return;
+
+	// time_msec是单调时钟毫秒数的低32位,大约49.7天回绕一次,
+	// 用当前时间的高位补全,比当前时间还晚说明高位刚进位
+	now_ms = get_now_in_ns() / 1000000ULL;
+	event_ms = (now_ms & ~(uint64_t)UINT32_MAX) | time_msec;
+	if (event_ms > now_ms && event_ms >= (1ULL << 32))
+		event_ms -= 1ULL << 32;
+	m->latency_pending[type] = event_ms * 1000000ULL;
+}
+
+/* 这一帧有新内容提交时,把等待中的输入转为等待显示,否则说明输入没有改变画面 */
+static void input_latency_commit(Monitor *m, bool committed) {
+	uint64_t now_ns = get_now_in_ns();
+
+	for (int i = 0; i < LATENCY_TYPES; i++) {
+		/* 超过1秒的认为和这一帧无关,比如只移动了硬件光标 */
+		if (committed && m->latency_pending[i] &&
+			now_ns - m->latency_pending[i] < 1000000000ULL &&
+			!m->latency_inflight[i])
+			m->latency_inflight[i] = m->latency_pending[i];
+		m->latency_pending[i] = 0;
+	}
+}
+
+void outputpresent(struct wl_listener *listener, void *data) {
+	Monitor *m = wl_container_of(listener, m, present);
+	struct wlr_output_event_present *event = data;
+	uint64_t when_ns;
+
+	if (!event->presented) {
+		m->governor_commit_ns = 0;
+		return;
+	}
+
+	when_ns = (uint64_t)event->when.tv_sec * 1000000000ULL +
+			  (uint64_t)event->when.tv_nsec;
+
+	// GPU的耗时只能从实际翻页的时间看出来,rendermon里只是提交了命令
+	if (m->governor_commit_ns && when_ns >= m->governor_commit_ns)
+		effect_governor_update(m, m->governor_commit_ns, when_ns);
+	m->governor_commit_ns = 0;
+	for (int i = 0; i < LATENCY_TYPES; i++) {
+		uint64_t input_ns = m->latency_inflight[i];
+		if (!input_ns)
+			continue;
+		m->latency_inflight[i] = 0;
+		if (when_ns < input_ns)
+			continue;
+
+		uint64_t latency = when_ns - input_ns;
+		LatencyHistogram *h = &input_latency[i];
+		int bucket = 0;
+		while (bucket < LATENCY_BUCKETS - 1 &&
+			   latency >= (500000ULL << bucket))
+			bucket++;
+		h->buckets[bucket]++;
+		h->count++;
+		h->sum_ns += latency;
+		h->max_ns = MAX(h->max_ns, latency);
+	}
+}
+
 void rendermon(struct wl_listener *listener, void *data) {
 	Monitor *m = wl_container_of(listener, m, frame);
 	Client *c, *tmp;
@@ -3737,6 +4500,16 @@ void rendermon(struct wl_listener *listener, void *data) {
 
 	struct timespec now;
 	bool need_more_frames = false;
+	bool committed = false;
+	uint64_t frame_begin_ns = get_now_in_ns();
+
+	if (!startup_first_frame_ns) {
+		startup_first_frame_ns = frame_begin_ns - startup_begin_ns;
+		wlr_log(WLR_DEBUG, "startup: first frame after %.2f ms",
+				startup_first_frame_ns / 1e6);
+	}
+
+	flush_interactive_grab(false);
 
 	for (i = 0; i < LENGTH(m->layers); i++) {
 		layer_list = &m->layers[i];
@@ -3759,7 +4532,23 @@ void rendermon(struct wl_listener *listener, void *data) {
 		need_more_frames = layer_draw_fadeout_frame(l) || need_more_frames;
 	}
 
-	wlr_scene_output_commit(m->scene_output, NULL);
+	if (check_tearing_frame_allow(m)) {
+		// 异步翻页提交,驱动不支持时退回普通提交
+		wlr_output_state_init(&pending);
+		if (wlr_scene_output_needs_frame(m->scene_output) &&
+			wlr_scene_output_build_state(m->scene_output, &pending, NULL)) {
+			pending.tearing_page_flip = true;
+			if (!wlr_output_test_state(m->wlr_output, &pending))
+				pending.tearing_page_flip = false;
+			committed = wlr_output_commit_state(m->wlr_output, &pending);
+		}
+	} else {
+		committed = wlr_scene_output_needs_frame(m->scene_output) &&
+					wlr_scene_output_commit(m->scene_output, NULL);
+	}
+	input_latency_commit(m, committed);
+	if (committed && !m->governor_commit_ns)
+		m->governor_commit_ns = get_now_in_ns();
 
 	// Send frame done notification
 	clock_gettime(CLOCK_MONOTONIC, &now);
@@ -3866,11 +4655,16 @@ run(char *startup_cmd) {
 	if (!socket)
 		die("startup: display_add_socket_auto");
 	setenv("WAYLAND_DISPLAY", socket, 1);
+	startup_mark("socket", false, 0);
+
+	/* 输出设备创建时会用到光标主题和动画曲线,启动后端前等待后台任务完成 */
+	join_startup_tasks();
 
 	/* Start the backend. This will enumerate outputs and inputs, become the DRM
 	 * master, etc */
 	if (!wlr_backend_start(backend))
 		die("startup: backend_start");
+	startup_mark("backend_start", false, 0);
 
 	/* Now that the socket exists and the backend is started, run the startup
 	 * command */
@@ -3885,12 +4679,14 @@ run(char *startup_cmd) {
 			die("startup: fork:");
 		if (child_pid == 0) {
 			setsid();
+			restore_child_signals();
 			dup2(piperw[0], STDIN_FILENO);
 			close(piperw[0]);
 			close(piperw[1]);
 			execl("/bin/sh", "/bin/sh", "-c", startup_cmd, NULL);
 			die("startup: execl:");
 		}
+		child_watch_add(child_pid, "autostart");
 		dup2(piperw[1], STDOUT_FILENO);
 		close(piperw[1]);
 		close(piperw[0]);
@@ -3917,6 +4713,8 @@ run(char *startup_cmd) {
 
 	run_exec();
 	run_exec_once();
+	startup_mark("autostart", false, 0);
+	print_startup_report();
 
 	/* Run the Wayland event loop. This does not return until you exit the
 	 * compositor. Starting the backend rigged up all of the necessary event
@@ -3964,12 +4762,11 @@ setfloating(Client *c, int floating) {
 		return;
 
 	if (c->isoverlay) {
-		wlr_scene_node_reparent(&c->scene->node, layers[LyrOverlay]);
+		client_set_scene_layer(c, LyrOverlay);
 	} else if (client_should_overtop(c) && c->isfloating) {
-		wlr_scene_node_reparent(&c->scene->node, layers[LyrFSorOverTop]);
+		client_set_scene_layer(c, LyrFSorOverTop);
 	} else {
-		wlr_scene_node_reparent(&c->scene->node,
-								layers[c->isfloating ? LyrFloat : LyrTile]);
+		client_set_scene_layer(c, c->isfloating ? LyrFloat : LyrTile);
 	}
 
 	target_box = c->geom;
@@ -4044,9 +4841,9 @@ void setmaxmizescreen(Client *c, int maxmizescreen) {
 
 	c->ismaxmizescreen = maxmizescreen;
 
-	wlr_scene_node_reparent(&c->scene->node, layers[maxmizescreen	? LyrTile
-													: c->isfloating ? LyrFloat
-																	: LyrTile]);
+	client_set_scene_layer(c, maxmizescreen	  ? LyrTile
+							  : c->isfloating ? LyrFloat
+											  : LyrTile);
 
 	if (maxmizescreen) {
 		if (c->isfloating)
@@ -4060,7 +4857,7 @@ void setmaxmizescreen(Client *c, int maxmizescreen) {
 		maxmizescreen_box.y = c->mon->w.y + gappov;
 		maxmizescreen_box.width = c->mon->w.width - 2 * gappoh;
 		maxmizescreen_box.height = c->mon->w.height - 2 * gappov;
-		wlr_scene_node_raise_to_top(&c->scene->node); // 将视图提升到顶层
+		client_raise_to_top(c); // 将视图提升到顶层
 		resize(c, maxmizescreen_box, 0);
 		c->ismaxmizescreen = 1;
 	} else {
@@ -4093,14 +4890,13 @@ void setfullscreen(Client *c, int fullscreen) // 用自定义全屏代理自带
 	client_set_fullscreen(c, fullscreen);
 
 	if (c->isoverlay) {
-		wlr_scene_node_reparent(&c->scene->node, layers[LyrOverlay]);
+		client_set_scene_layer(c, LyrOverlay);
 	} else if (client_should_overtop(c) && c->isfloating) {
-		wlr_scene_node_reparent(&c->scene->node, layers[LyrFSorOverTop]);
+		client_set_scene_layer(c, LyrFSorOverTop);
 	} else {
-		wlr_scene_node_reparent(&c->scene->node,
-								layers[fullscreen	   ? LyrFSorOverTop
-									   : c->isfloating ? LyrFloat
-													   : LyrTile]);
+		client_set_scene_layer(c, fullscreen	  ? LyrFSorOverTop
+								  : c->isfloating ? LyrFloat
+												  : LyrTile);
 	}
 
 	if (fullscreen) {
@@ -4112,7 +4908,7 @@ void setfullscreen(Client *c, int fullscreen) // 用自定义全屏代理自带
 		}
 
 		c->bw = 0;
-		wlr_scene_node_raise_to_top(&c->scene->node); // 将视图提升到顶层
+		client_raise_to_top(c); // 将视图提升到顶层
 		resize(c, c->mon->m, 1);
 		c->isfullscreen = 1;
 		// c->isfloating = 0;
@@ -4156,18 +4952,11 @@ void reset_keyboard_layout(void) {
 		return;
 	}
 
-	// Create context
-	struct xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-	if (!context) {
-		wlr_log(WLR_ERROR, "Failed to create XKB context");
-		return;
-	}
-
 	// Get layout abbreviations
 	char **layout_ids = calloc(num_layouts, sizeof(char *));
 	if (!layout_ids) {
 		wlr_log(WLR_ERROR, "Failed to allocate layout IDs");
-		goto cleanup_context;
+		return;
 	}
 
 	for (int i = 0; i < num_layouts; i++) {
@@ -4182,9 +4971,8 @@ void reset_keyboard_layout(void) {
 	// Keep the same rules but just reapply them
 	struct xkb_rule_names rules = xkb_rules;
 
-	// Create new keymap with current rules
-	struct xkb_keymap *new_keymap =
-		xkb_keymap_new_from_names(context, &rules, XKB_KEYMAP_COMPILE_NO_FLAGS);
+	// Get keymap for current rules from cache
+	struct xkb_keymap *new_keymap = keymap_cache_get(&rules);
 	if (!new_keymap) {
 		wlr_log(WLR_ERROR, "Failed to create keymap for layouts: %s",
 				rules.layout);
@@ -4213,9 +5001,146 @@ cleanup_layouts:
 		free(layout_ids[i]);
 	}
 	free(layout_ids);
+}
+
+static void monitor_count_tags(Monitor *m, unsigned int tags, int delta) {
+	for (unsigned int i = 0; i < LENGTH(tags); i++) {
+		if (tags & (1 << i))
+			m->pertag->tag_clients[i + 1] += delta;
+	}
+}
+
+// 窗口的显示器或tag变化后更新索引,只有在clients链表中的窗口才在索引里
+void client_index_update(Client *c) {
+	Monitor *m = c->mon;
+	unsigned int tags = m ? c->tags & TAGMASK : 0;
+
+	if (!c->indexed || (c->index_mon == m && c->index_tags == tags))
+		return;
+
+	if (c->index_mon) {
+		monitor_count_tags(c->index_mon, c->index_tags, -1);
+		if (c->index_mon != m)
+			wl_list_remove(&c->mon_link);
+	}
+	if (m) {
+		if (c->index_mon != m)
+			wl_list_insert(m->mon_clients.prev, &c->mon_link);
+		monitor_count_tags(m, tags, 1);
+	}
+	c->index_mon = m;
+	c->index_tags = tags;
+}
+
+void client_index_add(Client *c) {
+	if (!c->indexed) {
+		c->indexed = true;
+		c->index_mon = NULL;
+		c->index_tags = 0;
+	}
+	client_index_update(c);
+}
+
+void client_index_remove(Client *c) {
+	if (!c->indexed)
+		return;
+	if (c->index_mon) {
+		monitor_count_tags(c->index_mon, c->index_tags, -1);
+		wl_list_remove(&c->mon_link);
+	}
+	c->index_mon = NULL;
+	c->index_tags = 0;
+	c->indexed = false;
+}
+
+// tagmask中的tag在显示器上都没有窗口
+bool monitor_tags_empty(Monitor *m, unsigned int tagmask) {
+	for (unsigned int i = 0; i < LENGTH(tags); i++) {
+		if ((tagmask & (1 << i)) && m->pertag->tag_clients[i + 1])
+			return false;
+	}
+	return true;
+}
+
+// 单tag窗口归属对应tag的子树,多tag和全局窗口归属共享子树0
+static unsigned int client_owner_tag(Client *c) {
+	unsigned int i = 0;
+
+	if (c->isglobal || c->isunglobal || !(c->tags & TAGMASK) ||
+		(c->tags & (c->tags - 1)))
+		return 0;
+	while (!(c->tags & (1 << i)))
+		i++;
+	return i + 1;
+}
+
+static struct wlr_scene_tree *client_layer_tree(Client *c, int layer) {
+	if (!c->mon || !c->mon->pertag || layer != LyrTile)
+		return layers[layer];
+	return c->mon->pertag->tile_trees[client_owner_tag(c)];
+}
+
+void client_set_scene_layer(Client *c, int layer) {
+	c->scene_layer = layer;
+	client_sync_scene_tree(c);
+}
+
+// tag或者显示器变化后把窗口移到对应的子树
+void client_sync_scene_tree(Client *c) {
+	struct wlr_scene_tree *tree;
+
+	if (!c->scene)
+		return;
+	tree = client_layer_tree(c, c->scene_layer);
+	if (c->scene->node.parent != tree)
+		wlr_scene_node_reparent(&c->scene->node, tree);
+}
+
+bool client_hidden_by_tag_tree(Client *c, Monitor *m) {
+	unsigned int owner = client_owner_tag(c);
+
+	return owner && c->scene_layer == LyrTile &&
+		   c->scene->node.parent == client_layer_tree(c, c->scene_layer) &&
+		   !(m->tagset[m->seltags] & (1 << (owner - 1)));
+}
 
-cleanup_context:
-	xkb_context_unref(context);
+// 提升窗口时所在的tag子树也提升到其他子树之上,
+// 否则共享子树里的窗口会一直被当前tag子树的窗口盖住
+void client_raise_to_top(Client *c) {
+	struct wlr_scene_tree *parent = c->scene->node.parent;
+
+	wlr_scene_node_raise_to_top(&c->scene->node);
+	if (parent && parent != layers[c->scene_layer])
+		wlr_scene_node_raise_to_top(&parent->node);
+}
+
+// 显示当前tag的子树,正在做移出动画的tag也要保持显示
+void update_tag_trees(Monitor *m, unsigned int keep_tags) {
+	unsigned int visible = m->tagset[m->seltags] | keep_tags;
+
+	for (unsigned int i = 1; i <= LENGTH(tags); i++) {
+		bool enabled = visible & (1 << (i - 1));
+		wlr_scene_node_set_enabled(&m->pertag->tile_trees[i]->node, enabled);
+	}
+}
+
+// 显示器移除时先把还在子树里的窗口移回场景层,再销毁子树
+void destroy_tag_trees(Monitor *m) {
+	Client *c;
+	unsigned int i;
+
+	wl_list_for_each(c, &clients, link) {
+		for (i = 0; c->scene && i <= LENGTH(tags); i++) {
+			if (c->scene->node.parent == m->pertag->tile_trees[i]) {
+				wlr_scene_node_reparent(&c->scene->node,
+										layers[c->scene_layer]);
+				break;
+			}
+		}
+	}
+	for (i = 0; i <= LENGTH(tags); i++) {
+		wlr_scene_node_destroy(&m->pertag->tile_trees[i]->node);
+	}
 }
 
 void setmon(Client *c, Monitor *m, unsigned int newtags, bool focus) {
@@ -4233,6 +5158,8 @@ void setmon(Client *c, Monitor *m, unsigned int newtags, bool focus) {
 	}
 
 	c->mon = m;
+	client_index_update(c);
+	client_sync_scene_tree(c);
 
 	/* Scene graph sends surface leave/enter events on move and resize */
 	if (oldmon)
@@ -4243,6 +5170,7 @@ void setmon(Client *c, Monitor *m, unsigned int newtags, bool focus) {
 		c->tags =
 			newtags ? newtags
 					: m->tagset[m->seltags]; /* assign tags of target monitor */
+		client_index_update(c);
 		setfloating(c, c->isfloating);
 		setfullscreen(c, c->isfullscreen); /* This will call arrange(c->mon) */
 	}
@@ -4311,20 +5239,105 @@ void create_output(struct wlr_backend *backend, void *data) {
 #endif
 }
 
+void startup_mark(const char *name, bool worker, uint64_t duration_ns) {
+	uint64_t now = get_now_in_ns();
+
+	if (!worker) {
+		duration_ns = now - startup_last_mark_ns;
+		startup_last_mark_ns = now;
+	}
+	if (startup_phase_count < STARTUP_PHASES_MAX)
+		startup_phases[startup_phase_count++] =
+			(StartupPhase){name, duration_ns, worker};
+}
+
+/* 预热keymap缓存,键盘组创建前会先join这个任务 */
+void startup_compile_keymap(void) {
+	struct xkb_keymap *keymap = keymap_cache_get(&xkb_rules);
+
+	if (keymap)
+		xkb_keymap_unref(keymap);
+}
+
+void startup_load_cursor(void) {
+	wlr_xcursor_manager_load(cursor_mgr, 1);
+}
+
+static void *startup_task_thread(void *data) {
+	StartupTask *task = data;
+	uint64_t begin = get_now_in_ns();
+
+	task->func();
+	task->duration_ns = get_now_in_ns() - begin;
+	return NULL;
+}
+
+/* 这些任务只依赖已解析的配置,在主线程创建后端和全局对象时并行完成 */
+void start_startup_tasks(void) {
+	sigset_t all, old;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	for (int i = 0; i < LENGTH(startup_tasks); i++) {
+		StartupTask *task = &startup_tasks[i];
+		if (pthread_create(&task->thread, NULL, startup_task_thread, task) ==
+			0)
+			task->running = true;
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	/* 线程创建失败的任务在主线程同步执行 */
+	for (int i = 0; i < LENGTH(startup_tasks); i++) {
+		if (!startup_tasks[i].running)
+			startup_task_thread(&startup_tasks[i]);
+	}
+}
+
+void join_startup_task(StartupTask *task) {
+	if (task->running) {
+		pthread_join(task->thread, NULL);
+		task->running = false;
+	}
+}
+
+void join_startup_tasks(void) {
+	for (int i = 0; i < LENGTH(startup_tasks); i++)
+		join_startup_task(&startup_tasks[i]);
+	startup_mark("join_workers", false, 0);
+	for (int i = 0; i < LENGTH(startup_tasks); i++)
+		startup_mark(startup_tasks[i].name, true,
+					 startup_tasks[i].duration_ns);
+}
+
+void print_startup_report(void) {
+	for (int i = 0; i < startup_phase_count; i++)
+		wlr_log(WLR_DEBUG, "startup: %-16s %8.2f ms%s",
+				startup_phases[i].name, startup_phases[i].duration_ns / 1e6,
+				startup_phases[i].worker ? " (worker)" : "");
+	wlr_log(WLR_DEBUG, "startup: %-16s %8.2f ms", "total",
+			(startup_last_mark_ns - startup_begin_ns) / 1e6);
+}
+
 void setup(void) {
 
+	startup_begin_ns = startup_last_mark_ns = get_now_in_ns();
+
 	setenv("XCURSOR_SIZE", "24", 1);
 	setenv("XDG_CURRENT_DESKTOP", "mango", 1);
 
+	/* 后面的后端,键盘和光标都依赖配置(包括env),所以配置仍在最前面同步解析 */
 	parse_config();
-	init_baked_points();
+	startup_mark("config", false, 0);
 
-	int drm_fd, i, sig[] = {SIGCHLD, SIGINT, SIGTERM, SIGPIPE};
-	struct sigaction sa = {.sa_flags = SA_RESTART, .sa_handler = handlesig};
-	sigemptyset(&sa.sa_mask);
+	/* Creates an xcursor manager, another wlroots utility which loads up
+	 * Xcursor themes to source cursor images from and makes sure that cursor
+	 * images are available at all scale factors on the screen (necessary for
+	 * HiDPI support). Scaled cursors will be loaded with each output. */
+	// cursor_mgr = wlr_xcursor_manager_create(cursor_theme, 24);
+	cursor_mgr = wlr_xcursor_manager_create(config.cursor_theme, cursor_size);
+	start_startup_tasks();
 
-	for (i = 0; i < LENGTH(sig); i++)
-		sigaction(sig[i], &sa, NULL);
+	int drm_fd, i, sig[] = {SIGCHLD, SIGINT, SIGTERM, SIGPIPE};
 
 	wlr_log_init(log_level, NULL);
 
@@ -4332,6 +5345,11 @@ void setup(void) {
 	 * clients from the Unix socket, manging Wayland globals, and so on. */
 	dpy = wl_display_create();
 	event_loop = wl_display_get_event_loop(dpy);
+
+	/* 信号通过signalfd在事件循环里处理,不会打断任意位置的代码 */
+	for (i = 0; i < LENGTH(sig); i++)
+		wl_event_loop_add_signal(event_loop, sig[i], handlesig, NULL);
+	init_config_reload();
 	pointer_manager = wlr_relative_pointer_manager_v1_create(dpy);
 	/* The backend is a wlroots feature which abstracts the underlying input and
 	 * output hardware. The autocreate option will choose the most suitable
@@ -4343,6 +5361,7 @@ void setup(void) {
 	 * don't). */
 	if (!(backend = wlr_backend_autocreate(event_loop, &session)))
 		die("couldn't create backend");
+	startup_mark("backend", false, 0);
 
 	headless_backend = wlr_headless_backend_create(event_loop);
 	if (!headless_backend) {
@@ -4385,6 +5404,7 @@ void setup(void) {
 	/* Create a default allocator */
 	if (!(alloc = wlr_allocator_autocreate(backend, drw)))
 		die("couldn't create allocator");
+	startup_mark("renderer", false, 0);
 
 	/* This creates some hands-off wlroots interfaces. The compositor is
 	 * necessary for clients to allocate surfaces and the data device manager
@@ -4407,6 +5427,7 @@ void setup(void) {
 	wlr_subcompositor_create(dpy);
 	wlr_alpha_modifier_v1_create(dpy);
 	wlr_ext_data_control_manager_v1_create(dpy, 1);
+	tearing_control = wlr_tearing_control_manager_v1_create(dpy, 1);
 
 	/* Initializes the interface used to implement urgency hints */
 	activation = wlr_xdg_activation_v1_create(dpy);
@@ -4474,6 +5495,8 @@ void setup(void) {
 
 	relative_pointer_mgr = wlr_relative_pointer_manager_v1_create(dpy);
 
+	startup_mark("globals", false, 0);
+
 	/*
 	 * Creates a cursor, which is a wlroots utility for tracking the cursor
 	 * image shown on screen.
@@ -4481,13 +5504,6 @@ void setup(void) {
 	cursor = wlr_cursor_create();
 	wlr_cursor_attach_output_layout(cursor, output_layout);
 
-	/* Creates an xcursor manager, another wlroots utility which loads up
-	 * Xcursor themes to source cursor images from and makes sure that cursor
-	 * images are available at all scale factors on the screen (necessary for
-	 * HiDPI support). Scaled cursors will be loaded with each output. */
-	// cursor_mgr = wlr_xcursor_manager_create(cursor_theme, 24);
-	cursor_mgr = wlr_xcursor_manager_create(config.cursor_theme, cursor_size);
-
 	/*
 	 * wlr_cursor *only* displays an image on screen. It does not move around
 	 * when the pointer moves. However, we can attach input devices to it, and
@@ -4512,6 +5528,10 @@ void setup(void) {
 				  &request_set_cursor_shape);
 	hide_source = wl_event_loop_add_timer(wl_display_get_event_loop(dpy),
 										  hidecursor, cursor);
+	frame_pacer_timer =
+		wl_event_loop_add_timer(event_loop, frame_pacer_timeout, NULL);
+	grab_configure_timer =
+		wl_event_loop_add_timer(event_loop, grab_configure_timeout, NULL);
 
 	/*
 	 * Configures a seat, which is a single "seat" at which a user sits and
@@ -4519,6 +5539,8 @@ void setup(void) {
 	 * pointer, touch, and drawing tablet device. We also rig up a listener to
 	 * let us know when new input devices are available on the backend.
 	 */
+	startup_mark("cursor", false, 0);
+
 	wl_list_init(&keyboards);
 	wl_signal_add(&backend->events.new_input, &new_input_device);
 	virtual_keyboard_mgr = wlr_virtual_keyboard_manager_v1_create(dpy);
@@ -4552,6 +5574,7 @@ void setup(void) {
 	output_mgr = wlr_output_manager_v1_create(dpy);
 	wl_signal_add(&output_mgr->events.apply, &output_mgr_apply);
 	wl_signal_add(&output_mgr->events.test, &output_mgr_test);
+	startup_mark("seat", false, 0);
 
 	// blur
 	wlr_scene_set_blur_data(scene, blur_params.num_passes, blur_params.radius,
@@ -4565,7 +5588,7 @@ void setup(void) {
 	dwl_input_method_relay = calloc(1, sizeof(*dwl_input_method_relay));
 	dwl_input_method_relay = dwl_im_relay_create();
 
-	wl_global_create(dpy, &zdwl_ipc_manager_v2_interface, 2, NULL,
+	wl_global_create(dpy, &zdwl_ipc_manager_v2_interface, 4, NULL,
 					 dwl_ipc_manager_bind);
 
 	// 创建顶层管理句柄
@@ -4577,18 +5600,49 @@ void setup(void) {
 #ifdef XWAYLAND
 	/*
 	 * Initialise the XWayland X server.
-	 * It will be started when the first X client is started.
+	 * In lazy mode it will be started when the first X client connects,
+	 * or after xwayland_prewarm_delay seconds without input.
 	 */
-	xwayland = wlr_xwayland_create(dpy, compositor, !xwayland_persistence);
+	struct wlr_xwayland_server_options xwayland_options = {
+		.lazy = xwayland_lazy || !xwayland_persistence,
+		.enable_wm = true,
+		.terminate_delay = xwayland_persistence ? 0 : 10,
+	};
+
+	/* 非lazy模式在创建时就同步启动了,start信号来不及监听 */
+	if (!xwayland_options.lazy) {
+		xwayland_stats.starts = 1;
+		xwayland_stats.start_ns = get_now_in_ns();
+	}
+
+	xwayland_server = wlr_xwayland_server_create(dpy, &xwayland_options);
+	if (xwayland_server)
+		xwayland = wlr_xwayland_create_with_server(dpy, compositor,
+												   xwayland_server);
 	if (xwayland) {
 		wl_signal_add(&xwayland->events.ready, &xwayland_ready);
 		wl_signal_add(&xwayland->events.new_surface, &new_xwayland_surface);
+		wl_signal_add(&xwayland_server->events.start, &xwayland_server_start);
 
 		setenv("DISPLAY", xwayland->display_name, 1);
+
+		/* 不持久时服务器在最后一个客户端断开10秒后退出,
+		 * 预热的服务器没有客户端,很快就会退出,白白启动一次 */
+		if (xwayland_lazy && xwayland_persistence &&
+			xwayland_prewarm_delay > 0) {
+			xwayland_prewarm_timer = wl_event_loop_add_timer(
+				event_loop, xwayland_prewarm_timeout, NULL);
+			wl_event_source_timer_update(xwayland_prewarm_timer,
+										 xwayland_prewarm_delay * 1000);
+		}
 	} else {
+		wlr_xwayland_server_destroy(xwayland_server);
+		xwayland_server = NULL;
+		memset(&xwayland_stats, 0, sizeof(xwayland_stats));
 		fprintf(stderr,
 				"failed to setup XWayland X server, continuing without it\n");
 	}
+	startup_mark("xwayland", false, 0);
 #endif
 }
 
@@ -4605,6 +5659,7 @@ void tag_client(const Arg *arg, Client *target_client) {
 	Client *fc;
 	if (target_client && arg->ui & TAGMASK) {
 		target_client->tags = arg->ui & TAGMASK;
+		client_index_update(target_client);
 		wl_list_for_each(fc, &clients, link) {
 			if (fc && fc != target_client && target_client->tags & fc->tags &&
 				ISFULLSCREEN(fc) && !target_client->isfloating) {
@@ -4697,7 +5752,13 @@ void overview_restore(Client *c, const Arg *arg) {
 }
 
 void handlecursoractivity(void) {
-	wl_event_source_timer_update(hide_source, cursor_hide_timeout * 1000);
+	cursor_activity_ns = get_now_in_ns();
+
+	/* 已经设置的定时器到期时会自己顺延,不需要每次输入都重设 */
+	if (hide_timer_timeout != cursor_hide_timeout) {
+		hide_timer_timeout = cursor_hide_timeout;
+		wl_event_source_timer_update(hide_source, cursor_hide_timeout * 1000);
+	}
 
 	if (!cursor_hidden)
 		return;
@@ -4712,7 +5773,38 @@ void handlecursoractivity(void) {
 							   last_cursor.hotspot_x, last_cursor.hotspot_y);
 }
 
+void notify_input_activity(void) {
+	uint64_t now = get_now_in_ns();
+	uint64_t frame_ns = 16666667;
+
+	input_activity_seen = true;
+
+	// 每帧最多通知一次,高回报率的鼠标不会每个事件都重设idle定时器
+	if (selmon && selmon->wlr_output->refresh > 0)
+		frame_ns = 1000000000000ULL / selmon->wlr_output->refresh;
+	if (now - idle_notify_ns < frame_ns)
+		return;
+	idle_notify_ns = now;
+	wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
+}
+
 int hidecursor(void *data) {
+	uint64_t timeout_ns = (uint64_t)cursor_hide_timeout * 1000000000ULL;
+	uint64_t elapsed = get_now_in_ns() - cursor_activity_ns;
+
+	if (!cursor_hide_timeout) {
+		hide_timer_timeout = 0;
+		return 0;
+	}
+
+	/* 期间有过活动,只等待剩下的时间 */
+	if (elapsed < timeout_ns) {
+		wl_event_source_timer_update(
+			hide_source, (timeout_ns - elapsed + 999999) / 1000000);
+		return 0;
+	}
+
+	hide_timer_timeout = 0;
 	wlr_cursor_unset_image(cursor);
 	cursor_hidden = true;
 	return 1;
@@ -4859,6 +5951,7 @@ void unmapnotify(struct wl_listener *listener, void *data) {
 		if (!c->swallowing)
 			wl_list_remove(&c->link);
 		setmon(c, NULL, 0, true);
+		client_index_remove(c);
 		if (!c->swallowing)
 			wl_list_remove(&c->flink);
 	}
@@ -4880,6 +5973,7 @@ void unmapnotify(struct wl_listener *listener, void *data) {
 		c->swallowing = NULL;
 	}
 
+	client_clear_effect_buffers(c);
 	wlr_scene_node_destroy(&c->scene->node);
 	printstatus();
 	motionnotify(0, NULL, 0, 0, 0, 0);
@@ -5021,18 +6115,91 @@ void updatemons(struct wl_listener *listener, void *data) {
 	wlr_output_manager_v1_set_configuration(output_mgr, config);
 }
 
+// 把当前标题和appid推送给foreign-toplevel和ipc
+void publish_client_title(Client *c) {
+	const char *title = client_get_title(c);
+	const char *appid = client_get_appid(c);
+	bool changed = false;
+
+	c->title_timer_armed = false;
+	c->title_published_ns = get_now_in_ns();
+
+	if (title &&
+		(!c->published_title || strcmp(title, c->published_title) != 0)) {
+		free(c->published_title);
+		c->published_title = strdup(title);
+		if (c->foreign_toplevel)
+			wlr_foreign_toplevel_handle_v1_set_title(c->foreign_toplevel,
+													 title);
+		changed = true;
+	}
+
+	if (appid &&
+		(!c->published_appid || strcmp(appid, c->published_appid) != 0)) {
+		free(c->published_appid);
+		c->published_appid = strdup(appid);
+		if (c->foreign_toplevel)
+			wlr_foreign_toplevel_handle_v1_set_app_id(c->foreign_toplevel,
+													  appid);
+		changed = true;
+	}
+
+	if (changed && c->mon && c == focustop(c->mon))
+		printstatus();
+}
+
+static int client_title_timeout(void *data) {
+	Client *c = data;
+
+	if (!c->iskilling)
+		publish_client_title(c);
+	else
+		c->title_timer_armed = false;
+	return 0;
+}
+
+// 距上次发布不足title_update_interval毫秒时延后发布,到期时取最新值
+void queue_client_title_update(Client *c) {
+	uint64_t interval = (uint64_t)title_update_interval * 1000000;
+	uint64_t elapsed = get_now_in_ns() - c->title_published_ns;
+
+	if (c->title_timer_armed)
+		return;
+
+	if (!interval || elapsed >= interval) {
+		publish_client_title(c);
+		return;
+	}
+
+	if (!c->title_timer)
+		c->title_timer =
+			wl_event_loop_add_timer(event_loop, client_title_timeout, c);
+	if (!c->title_timer) {
+		publish_client_title(c);
+		return;
+	}
+
+	wl_event_source_timer_update(c->title_timer,
+								 (interval - elapsed + 999999) / 1000000);
+	c->title_timer_armed = true;
+}
+
 void updatetitle(struct wl_listener *listener, void *data) {
 	Client *c = wl_container_of(listener, c, set_title);
 
 	if (!c || c->iskilling)
 		return;
 
-	const char *title;
-	title = client_get_title(c);
-	if (title && c->foreign_toplevel)
-		wlr_foreign_toplevel_handle_v1_set_title(c->foreign_toplevel, title);
-	if (c == focustop(c->mon))
-		printstatus();
+	queue_client_title_update(c);
+}
+
+void updateappid(struct wl_listener *listener, void *data) {
+	Client *c = wl_container_of(listener, c, set_appid);
+
+	if (!c || c->iskilling)
+		return;
+
+	queue_client_title_update(c);
 }
 
 void // 17 fix to 0.5
@@ -5155,6 +6322,7 @@ void activatex11(struct wl_listener *listener, void *data) {
 	if (c->isminied) {
 		c->isminied = 0;
 		c->tags = c->mini_restore_tag;
+		client_index_update(c);
 		c->is_scratchpad_show = 0;
 		c->is_in_scratchpad = 0;
 		c->isnamedscratchpad = 0;
@@ -5187,6 +6355,7 @@ void activatex11(struct wl_listener *listener, void *data) {
 void configurex11(struct wl_listener *listener, void *data) {
 	Client *c = wl_container_of(listener, c, configure);
 	struct wlr_xwayland_surface_configure_event *event = data;
+	x11_configure_requests++;
 	if (!client_surface(c) || !client_surface(c)->mapped) {
 		wlr_xwayland_surface_configure(c->surface.xwayland, event->x, event->y,
 									   event->width, event->height);
@@ -5207,7 +6376,12 @@ void configurex11(struct wl_listener *listener, void *data) {
 								.height = event->height + c->bw * 2},
 			   0);
 	} else {
-		arrange(c->mon, false);
+		/* 平铺窗口的大小由布局决定,和请求的大小无关,
+		 * 直接重发当前几何,不需要重新布局 */
+		wlr_xwayland_surface_configure(
+			c->surface.xwayland, c->geom.x + c->bw, c->geom.y + c->bw,
+			c->geom.width - 2 * c->bw, c->geom.height - 2 * c->bw);
+		x11_configure_absorbed++;
 	}
 }
 
@@ -5229,6 +6403,7 @@ void createnotifyx11(struct wl_listener *listener, void *data) {
 		   fullscreennotify);
 	LISTEN(&xsurface->events.set_hints, &c->set_hints, sethints);
 	LISTEN(&xsurface->events.set_title, &c->set_title, updatetitle);
+	LISTEN(&xsurface->events.set_class, &c->set_appid, updateappid);
 	LISTEN(&xsurface->events.request_maximize, &c->maximize, maximizenotify);
 	LISTEN(&xsurface->events.request_minimize, &c->minimize, minimizenotify);
 }
@@ -5259,9 +6434,69 @@ void sethints(struct wl_listener *listener, void *data) {
 		client_set_border_color(c, urgentcolor);
 }
 
+void xwaylandserverstart(struct wl_listener *listener, void *data) {
+	xwayland_stats.starts++;
+	xwayland_stats.start_ns = get_now_in_ns();
+
+	/* 已经启动过了,不再需要预热 */
+	if (xwayland_prewarm_timer) {
+		wl_event_source_remove(xwayland_prewarm_timer);
+		xwayland_prewarm_timer = NULL;
+	}
+}
+
+/* 一段时间没有输入时主动连一下X socket,让lazy模式的XWayland提前启动 */
+int xwayland_prewarm_timeout(void *data) {
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	int fd;
+
+	if (input_activity_seen) {
+		input_activity_seen = false;
+		wl_event_source_timer_update(xwayland_prewarm_timer,
+									 xwayland_prewarm_delay * 1000);
+		return 0;
+	}
+
+	if (xwayland_server->pid > 0)
+		return 0;
+
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/.X11-unix/X%d",
+			 xwayland_server->display);
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0)
+		return 0;
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 &&
+		errno != EINPROGRESS && errno != EAGAIN) {
+		wlr_log(WLR_ERROR, "failed to prewarm XWayland: %s", strerror(errno));
+		close(fd);
+		return 0;
+	}
+
+	/* 连接保持到XWayland就绪,避免服务器启动前连接被丢弃 */
+	xwayland_prewarm_fd = fd;
+	xwayland_stats.prewarms++;
+	return 0;
+}
+
 void xwaylandready(struct wl_listener *listener, void *data) {
 	struct wlr_xcursor *xcursor;
 
+	if (xwayland_stats.start_ns) {
+		xwayland_stats.last_latency_ns =
+			get_now_in_ns() - xwayland_stats.start_ns;
+		xwayland_stats.max_latency_ns = MAX(xwayland_stats.max_latency_ns,
+											xwayland_stats.last_latency_ns);
+		xwayland_stats.start_ns = 0;
+		wlr_log(WLR_INFO, "XWayland ready %.1f ms after start",
+				xwayland_stats.last_latency_ns / 1e6);
+	}
+
+	if (xwayland_prewarm_fd >= 0) {
+		close(xwayland_prewarm_fd);
+		xwayland_prewarm_fd = -1;
+	}
+
 	/* assign the one and only seat */
 	wlr_xwayland_set_seat(xwayland, seat);
 
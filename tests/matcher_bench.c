@@ -0,0 +1,78 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matcher.h"
+#include "util.h"
+
+/* 对比模式集合和逐条regex_match匹配一批窗口规则的耗时 */
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+#define LONG_TITLE_LEN 200
+#define ROUNDS 2000
+
+static const char *patterns[] = {
+	"^firefox$",  "^org\\.gnome", "term$",	   "kitty",
+	".*fox.*",	  "^fire",		  "\\.desktop", "^(foot|kitty)$",
+	"[Ff]ire",	  "\\d+",		  "x(y|z)w",	   "a.*b.*c.*d.*e.*z.*q",
+	"(a|b|c|d|e)*z", ".*e.*e.*e.*e.*x", "^Alacritty$", "^mpv$",
+};
+
+static uint64_t bench_set(const char **strs, unsigned int str_count) {
+	PatternSet *set = pattern_set_create();
+	unsigned char matched[LENGTH(patterns)];
+	uint64_t begin;
+
+	for (unsigned int i = 0; i < LENGTH(patterns); i++)
+		pattern_set_add(set, patterns[i], i);
+	pattern_set_compile(set);
+
+	begin = get_now_in_ns();
+	for (unsigned int r = 0; r < ROUNDS; r++) {
+		for (unsigned int j = 0; j < str_count; j++) {
+			memset(matched, 0, sizeof(matched));
+			pattern_set_match(set, strs[j], matched);
+		}
+	}
+	begin = get_now_in_ns() - begin;
+
+	pattern_set_destroy(set);
+	return begin;
+}
+
+static uint64_t bench_regex_match(const char **strs, unsigned int str_count) {
+	uint64_t begin = get_now_in_ns();
+
+	for (unsigned int r = 0; r < ROUNDS; r++) {
+		for (unsigned int j = 0; j < str_count; j++) {
+			for (unsigned int i = 0; i < LENGTH(patterns); i++)
+				regex_match(patterns[i], strs[j]);
+		}
+	}
+	return get_now_in_ns() - begin;
+}
+
+int main(void) {
+	char title[LONG_TITLE_LEN + 1];
+	const char *strs[] = {
+		"firefox", "org.gnome.Terminal", "kitty", "foot", "app.desktop", title,
+	};
+	uint64_t set_ns, regex_ns;
+	int i;
+
+	strcpy(title, "firefox xyw ");
+	for (i = strlen(title); i < LONG_TITLE_LEN; i++)
+		title[i] = "abcde"[i % 5];
+	title[i] = '\0';
+
+	set_ns = bench_set(strs, LENGTH(strs));
+	regex_ns = bench_regex_match(strs, LENGTH(strs));
+
+	printf("pattern_set_match: %.2f us per string\n",
+		   set_ns / 1e3 / (ROUNDS * LENGTH(strs)));
+	printf("regex_match:       %.2f us per string\n",
+		   regex_ns / 1e3 / (ROUNDS * LENGTH(strs)));
+	return 0;
+}
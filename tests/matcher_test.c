@@ -0,0 +1,110 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "matcher.h"
+#include "util.h"
+
+/* 模式集合的结果必须和逐条regex_match一致 */
+
+#define LENGTH(X) (sizeof X / sizeof X[0])
+#define LONG_TITLE_LEN 200
+
+static int failures;
+
+static void check_set(const char *name, const char **patterns,
+					  unsigned int count, const char **strs,
+					  unsigned int str_count) {
+	PatternSet *set = pattern_set_create();
+	unsigned char *matched = ecalloc(count, 1);
+
+	for (unsigned int i = 0; i < count; i++)
+		pattern_set_add(set, patterns[i], i);
+	pattern_set_compile(set);
+
+	for (unsigned int j = 0; j < str_count; j++) {
+		memset(matched, 0, count);
+		pattern_set_match(set, strs[j], matched);
+
+		for (unsigned int i = 0; i < count; i++) {
+			int expected = regex_match(patterns[i], strs[j]);
+			if (matched[i] != expected) {
+				fprintf(stderr, "%s: pattern \"%s\" on \"%.40s\": got %d, "
+								"expected %d\n",
+						name, patterns[i], strs[j], matched[i], expected);
+				failures++;
+			}
+		}
+	}
+
+	free(matched);
+	pattern_set_destroy(set);
+}
+
+static void test_literals(void) {
+	const char *patterns[] = {
+		"^firefox$", "^org\\.gnome", "term$",	 "kitty", ".*fox.*",
+		"^$",		 "$",			 "",		 "a\\$", "^fire",
+		"^.*fox",	 "fox.*$",		 "\\.desktop", "nomatch$",
+	};
+	const char *strs[] = {
+		"firefox", "org.gnome.Terminal", "kitty-term", "", "a$b",
+		"term\n",  "firefox\n",			 "app.desktop",
+	};
+
+	check_set("literals", patterns, LENGTH(patterns), strs, LENGTH(strs));
+}
+
+static void test_regexes(void) {
+	const char *patterns[] = {
+		"fo+x", "(a)\\1", "[Ff]ire", "x|y", "(?i)FIRE", "\\Qfire",
+		"^(foot|kitty)$", "\\d+", "(?<name>ab)\\k<name>",
+	};
+	const char *strs[] = {
+		"foox", "aa", "Firefox", "yes", "fire", "foot", "abab", "v123", "",
+	};
+
+	check_set("regexes", patterns, LENGTH(patterns), strs, LENGTH(strs));
+}
+
+/* 长标题配上回溯很多的规则,每条规则都要正确匹配 */
+static void test_long_title(void) {
+	const char *patterns[] = {
+		"a.*b.*c.*d.*e.*z.*q",
+		"x(y|z)w",
+		"firefox (xyw|abc)",
+		"(a|b|c|d|e)*z",
+		".*e.*e.*e.*e.*x",
+		"^firefox",
+		"abcde$",
+	};
+	char head[LONG_TITLE_LEN + 1], tail[LONG_TITLE_LEN + 1];
+	const char *strs[] = {head, tail};
+	int i;
+
+	// 可匹配的片段分别放在开头和结尾
+	strcpy(head, "firefox xyw ");
+	for (i = strlen(head); i < LONG_TITLE_LEN; i++)
+		head[i] = "abcde"[i % 5];
+	head[i] = '\0';
+
+	for (i = 0; i < LONG_TITLE_LEN - 12; i++)
+		tail[i] = "abcde"[i % 5];
+	strcpy(tail + i, " firefox xyw");
+
+	check_set("long title", patterns, LENGTH(patterns), strs, LENGTH(strs));
+}
+
+int main(void) {
+	test_literals();
+	test_regexes();
+	test_long_title();
+
+	if (failures) {
+		fprintf(stderr, "%d failures\n", failures);
+		return 1;
+	}
+	return 0;
+}